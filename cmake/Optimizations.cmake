@@ -14,3 +14,11 @@ endmacro()
 if(CMAKE_CXX_COMPILER_ID MATCHES ".*Clang" OR CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
     set(CMAKE_CXX_FLAGS_DEBUG "-g -Og")
 endif()
+
+# Neither errno nor floating point exceptions are checked. Without them the compiler can vectorise loops calling sqrt
+# or selecting between computed values, the results do not change.
+function(disable_math_traps target)
+    if(CMAKE_CXX_COMPILER_ID MATCHES ".*Clang" OR CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        target_compile_options(${target} INTERFACE -fno-math-errno -fno-trapping-math)
+    endif()
+endfunction()
@@ -0,0 +1,355 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "Instrumentation.hpp"
+#include "phys/Collision.hpp"
+#include "phys/CollisionTests.hpp"
+#include "phys/Shapes.hpp"
+#include <CLI/CLI.hpp>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+struct Options
+{
+    uint32_t pairs{4096};
+    uint32_t runs{200};
+    uint32_t seed{1};
+    std::string outputFile;
+};
+
+int parseCommandLine(int argc, char** argv, Options& options)
+{
+    CLI::App app{"Micro benchmark of the scalar and the batched narrow phase tests", "ngn_bench_narrowphase"};
+
+    app.add_option("-n,--pairs", options.pairs, "Number of shape pairs per kernel");
+    app.add_option("-r,--runs", options.runs, "Number of times all pairs are tested");
+    app.add_option("--seed", options.seed, "Seed of the random generator");
+    app.add_option("-o,--output", options.outputFile, "Write the JSON report to this file instead of stdout");
+
+    try
+    {
+        app.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return app.exit(e);
+    }
+
+    if (options.pairs == 0 || options.runs == 0)
+    {
+        std::cerr << "At least one pair must be tested" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+std::string_view kernelName(ngn::CollisionKernel kernel)
+{
+    switch (kernel)
+    {
+        using enum ngn::CollisionKernel;
+
+        case CircleCircle:
+            return "circleCircle";
+
+        case CircleCapsule:
+            return "circleCapsule";
+
+        case CapsuleCircle:
+            return "capsuleCircle";
+
+        case CapsuleCapsule:
+            return "capsuleCapsule";
+
+        case Polygon:
+            return "polygon";
+
+        case None:
+            break;
+    }
+
+    return "none";
+}
+
+// shapes about the size of the game's bodies and walls, close enough that about half of the pairs collide
+class ShapeGenerator
+{
+public:
+    explicit ShapeGenerator(uint32_t seed) :
+        random_{seed}
+    {
+    }
+
+    ngn::Shape circle()
+    {
+        return ngn::Shape{ngn::Circle{.center = position(), .radius = uniform(2.0f, 32.0f)}};
+    }
+
+    // lines and capsules alternate, both are tested by the capsule kernels
+    ngn::Shape segment()
+    {
+        const auto start = position();
+        const auto end = start + glm::vec2{uniform(-64.0f, 64.0f), uniform(-64.0f, 64.0f)};
+
+        if (line_ = !line_; line_)
+            return ngn::Shape{ngn::Line{.start = start, .end = end}};
+        return ngn::Shape{ngn::Capsule{.start = start, .end = end, .radius = uniform(2.0f, 16.0f)}};
+    }
+
+private:
+    float uniform(float min, float max) { return std::uniform_real_distribution<float>{min, max}(random_); }
+
+    glm::vec2 position() { return {uniform(0.0f, 96.0f), uniform(0.0f, 96.0f)}; }
+
+private:
+    std::mt19937 random_;
+    bool line_{};
+};
+
+// The shapes as segments with a radius for the reference, circles have both ends at the center.
+class Segment
+{
+public:
+    glm::vec2 start;
+    glm::vec2 end;
+    float radius;
+};
+
+Segment toSegment(const ngn::Shape& shape)
+{
+    // the thickness the collision tests give lines
+    constexpr float lineWidth = 0.02f;
+
+    switch (shape.type)
+    {
+        using enum ngn::Shape::Type;
+
+        case Circle:
+            return {shape.circle.center, shape.circle.center, shape.circle.radius};
+
+        case Line:
+            return {shape.line.start, shape.line.end, lineWidth};
+
+        case Capsule:
+        case Box:
+        case ConvexPolygon:
+        case Invalid:
+            break;
+    }
+
+    return {shape.capsule.start, shape.capsule.end, shape.capsule.radius};
+}
+
+// Brute force distance of two segments, which samples lhs densely instead of relying on the closest points like the
+// tests do. It is too large by at most half the sample step, which is returned as tolerance.
+float referenceDistance(const Segment& lhs, const Segment& rhs, float& tolerance)
+{
+    constexpr uint32_t samples = 1024;
+
+    const auto rhsAxis = rhs.end - rhs.start;
+    const auto rhsAxisLen2 = glm::dot(rhsAxis, rhsAxis);
+
+    auto dist = std::numeric_limits<float>::max();
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        const auto point = glm::mix(lhs.start, lhs.end, static_cast<float>(i) / (samples - 1));
+        const auto t = rhsAxisLen2 > 0.0f ? glm::clamp(glm::dot(rhsAxis, point - rhs.start) / rhsAxisLen2, 0.0f, 1.0f)
+                                          : 0.0f;
+        dist = std::min(dist, glm::distance(point, rhs.start + rhsAxis * t));
+    }
+
+    tolerance = glm::distance(lhs.start, lhs.end) / (2 * (samples - 1)) + 1e-3f;
+    return dist;
+}
+
+class KernelResult
+{
+public:
+    ngn::CollisionKernel kernel;
+    uint64_t scalarTime{};
+    uint64_t batchedTime{};
+    uint32_t colliding{};
+    // pairs where both disagree about colliding
+    uint32_t mismatches{};
+    float maxPenetrationError{};
+    float maxDirectionError{};
+    // pairs where the brute force reference clearly disagrees about colliding, or the penetration of separate segments
+    uint32_t scalarReferenceMismatches{};
+    uint32_t batchedReferenceMismatches{};
+};
+
+KernelResult runKernel(const Options& options, ngn::CollisionKernel kernel, ShapeGenerator& generator)
+{
+    using ngn::instrumentation::cpuTimer;
+
+    using enum ngn::CollisionKernel;
+
+    const auto lhsCircle = kernel == CircleCircle || kernel == CircleCapsule;
+    const auto rhsCircle = kernel == CircleCircle || kernel == CapsuleCircle;
+
+    std::vector<ngn::Shape> lhsShapes;
+    std::vector<ngn::Shape> rhsShapes;
+    for (uint32_t i = 0; i < options.pairs; i++)
+    {
+        lhsShapes.push_back(lhsCircle ? generator.circle() : generator.segment());
+        rhsShapes.push_back(rhsCircle ? generator.circle() : generator.segment());
+    }
+
+    // the batched tests take the shapes by pointer, like the narrow phase does
+    std::vector<const ngn::Shape*> lhs;
+    std::vector<const ngn::Shape*> rhs;
+    for (uint32_t i = 0; i < options.pairs; i++)
+    {
+        lhs.push_back(&lhsShapes[i]);
+        rhs.push_back(&rhsShapes[i]);
+    }
+
+    std::vector<ngn::Collision> scalar(options.pairs);
+    std::vector<ngn::Collision> batched(options.pairs);
+
+    KernelResult result{.kernel = kernel};
+
+    for (uint32_t run = 0; run < options.runs; run++)
+    {
+        auto t0 = cpuTimer();
+        for (uint32_t i = 0; i < options.pairs; i++)
+            ngn::testCollision(scalar[i], *lhs[i], *rhs[i]);
+        auto t1 = cpuTimer();
+        result.scalarTime += t1 - t0;
+
+        t0 = cpuTimer();
+        ngn::testCollisions(kernel, lhs, rhs, batched);
+        t1 = cpuTimer();
+        result.batchedTime += t1 - t0;
+    }
+
+    // checked against the reference too, as both paths share the same approach and could be wrong in the same way
+    auto agrees = [](const ngn::Collision& collision, const Segment& lhs, const Segment& rhs)
+    {
+        float tolerance{};
+        const auto dist = referenceDistance(lhs, rhs, tolerance);
+        const auto radiusSum = lhs.radius + rhs.radius;
+
+        if (dist + tolerance < radiusSum && !collision.colliding)
+            return false;
+        if (dist - tolerance > radiusSum && collision.colliding)
+            return false;
+
+        // crossing segments are separated along the least penetration axis instead
+        return dist <= tolerance || glm::abs(collision.penetration - (radiusSum - dist)) <= tolerance;
+    };
+
+    for (uint32_t i = 0; i < options.pairs; i++)
+    {
+        if (scalar[i].colliding)
+            result.colliding++;
+
+        const auto lhsSegment = toSegment(lhsShapes[i]);
+        const auto rhsSegment = toSegment(rhsShapes[i]);
+        if (!agrees(scalar[i], lhsSegment, rhsSegment))
+            result.scalarReferenceMismatches++;
+        if (!agrees(batched[i], lhsSegment, rhsSegment))
+            result.batchedReferenceMismatches++;
+
+        if (scalar[i].colliding != batched[i].colliding)
+        {
+            result.mismatches++;
+            continue;
+        }
+
+        if (!scalar[i].colliding)
+            continue;
+
+        result.maxPenetrationError = std::max(result.maxPenetrationError,
+                                              glm::abs(scalar[i].penetration - batched[i].penetration));
+        result.maxDirectionError = std::max(result.maxDirectionError,
+                                            glm::length(scalar[i].direction - batched[i].direction));
+    }
+
+    return result;
+}
+
+void writeReport(std::ostream& out, const Options& options, const std::vector<KernelResult>& results)
+{
+    const auto cpuTimerFreq = static_cast<double>(ngn::instrumentation::calcCpuTimerFreq());
+    const auto toNs = [cpuTimerFreq, &options](uint64_t ticks)
+    {
+        return static_cast<double>(ticks) / cpuTimerFreq * 1e9 / (static_cast<double>(options.runs) * options.pairs);
+    };
+
+    out << std::fixed << std::setprecision(4);
+
+    out << "{\n";
+    out << "  \"config\": {"
+        << "\"pairs\": " << options.pairs
+        << ", \"runs\": " << options.runs
+        << ", \"seed\": " << options.seed
+        << "},\n";
+    out << "  \"kernels\": {\n";
+
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        const auto& result = results[i];
+
+        out << "      \"" << kernelName(result.kernel) << "\": {"
+            << "\"scalarNsPerPair\": " << toNs(result.scalarTime)
+            << ", \"batchedNsPerPair\": " << toNs(result.batchedTime)
+            << ", \"speedup\": " << static_cast<double>(result.scalarTime) / static_cast<double>(result.batchedTime)
+            << ", \"colliding\": " << result.colliding
+            << ", \"mismatches\": " << result.mismatches
+            << ", \"maxPenetrationError\": " << result.maxPenetrationError
+            << ", \"maxDirectionError\": " << result.maxDirectionError
+            << ", \"scalarReferenceMismatches\": " << result.scalarReferenceMismatches
+            << ", \"batchedReferenceMismatches\": " << result.batchedReferenceMismatches
+            << "}" << (i + 1 == results.size() ? "" : ",") << "\n";
+    }
+
+    out << "  }\n";
+    out << "}\n";
+}
+
+void runBenchmarks(std::ostream& out, const Options& options)
+{
+    ShapeGenerator generator{options.seed};
+
+    std::vector<KernelResult> results;
+    for (const auto kernel : {ngn::CollisionKernel::CircleCircle, ngn::CollisionKernel::CircleCapsule,
+                              ngn::CollisionKernel::CapsuleCircle, ngn::CollisionKernel::CapsuleCapsule})
+    {
+        results.push_back(runKernel(options, kernel, generator));
+    }
+
+    writeReport(out, options, results);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    int ret = parseCommandLine(argc, argv, options);
+    if (ret != 0)
+        return ret;
+
+    if (!options.outputFile.empty())
+    {
+        std::ofstream output{options.outputFile};
+        if (!output)
+        {
+            std::cerr << "Failed to open output file " << options.outputFile << std::endl;
+            return 1;
+        }
+        runBenchmarks(output, options);
+    }
+    else
+    {
+        runBenchmarks(std::cout, options);
+    }
+
+    return 0;
+}
@@ -0,0 +1,351 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "Allocators.hpp"
+#include "Instrumentation.hpp"
+#include "JobSystem.hpp"
+#include "Scenarios.hpp"
+#include "phys/World.hpp"
+#include <CLI/CLI.hpp>
+#include <entt/entt.hpp>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+struct Options
+{
+    std::string scenario{"maze"};
+    ScenarioConfig scenarioConfig{};
+    std::string broadphase{"tree"};
+    std::vector<ngn::BroadphaseType> broadphaseTypes;
+    float gridCellSize{128.0f};
+    uint32_t solverIterations{8};
+    bool noWarmStarting{false};
+    uint32_t frames{1000};
+    uint32_t warmupFrames{60};
+    float deltaTime{1.0f / 60.0f};
+    std::size_t frameMemory{100 * 1024 * 1024};
+    int32_t workers{-1};
+    std::string outputFile;
+};
+
+bool parseBroadphaseTypes(std::string_view name, std::vector<ngn::BroadphaseType>& types)
+{
+    if (name == "tree")
+        types = {ngn::BroadphaseType::Tree};
+    else if (name == "grid")
+        types = {ngn::BroadphaseType::Grid};
+    else if (name == "all")
+        types = {ngn::BroadphaseType::Tree, ngn::BroadphaseType::Grid};
+    else
+        return false;
+    return true;
+}
+
+std::string_view broadphaseTypeName(ngn::BroadphaseType type)
+{
+    switch (type)
+    {
+        using enum ngn::BroadphaseType;
+
+        case Tree:
+            return "tree";
+
+        case Grid:
+            return "grid";
+    }
+
+    return "unknown";
+}
+
+int parseCommandLine(int argc, char** argv, Options& options)
+{
+    CLI::App app{"Headless benchmark of the physics world", "ngn_bench_phys"};
+
+    app.add_option("-s,--scenario", options.scenario, "Scenario to run (maze, capsules, shots)");
+    app.add_option("-n,--bodies", options.scenarioConfig.bodyCount, "Number of dynamic bodies");
+    app.add_option("-m,--maze-size", options.scenarioConfig.mazeSize, "Number of maze blocks per row");
+    app.add_option("--seed", options.scenarioConfig.seed, "Seed of the random generator");
+    app.add_option("-b,--broadphase", options.broadphase,
+                   "Broadphase of the dynamic bodies (tree, grid, all), all runs the same scene with each of them");
+    app.add_option("--cell-size", options.gridCellSize, "Cell size of the grid broadphase");
+    app.add_option("-i,--iterations", options.solverIterations, "Velocity iterations of the contact solver");
+    app.add_flag("--no-warm-start", options.noWarmStarting, "Start every solver update from zero impulses");
+    app.add_option("-f,--frames", options.frames, "Number of measured frames");
+    app.add_option("-w,--warmup", options.warmupFrames, "Number of frames to run before measuring");
+    app.add_option("--dt", options.deltaTime, "Time step per frame in seconds");
+    app.add_option("--frame-memory", options.frameMemory, "Size of the frame memory arena in bytes");
+    app.add_option("-j,--workers", options.workers, "Number of job worker threads, -1 for one per hardware thread");
+    app.add_option("-o,--output", options.outputFile, "Write the JSON report to this file instead of stdout");
+
+    try
+    {
+        app.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return app.exit(e);
+    }
+
+    if (!parseScenarioType(options.scenario, options.scenarioConfig.type))
+    {
+        std::cerr << "Unknown scenario: " << options.scenario << std::endl;
+        return 1;
+    }
+
+    if (!parseBroadphaseTypes(options.broadphase, options.broadphaseTypes))
+    {
+        std::cerr << "Unknown broadphase: " << options.broadphase << std::endl;
+        return 1;
+    }
+
+    if (options.frames == 0)
+    {
+        std::cerr << "At least one frame must be measured" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+class Accumulator
+{
+public:
+    void add(uint64_t value)
+    {
+        total += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        count++;
+    }
+
+    double mean() const { return count ? static_cast<double>(total) / static_cast<double>(count) : 0.0; }
+
+    uint64_t total{};
+    uint64_t min{std::numeric_limits<uint64_t>::max()};
+    uint64_t max{};
+    uint64_t count{};
+};
+
+class Results
+{
+public:
+    Accumulator updateActive;
+    Accumulator integrate;
+    Accumulator updateTree;
+    Accumulator findPossibleCollisions;
+    Accumulator findActualCollisions;
+    Accumulator resolveCollisions;
+    Accumulator updateSleep;
+    Accumulator total;
+
+    Accumulator moved;
+    Accumulator possibleCollisions;
+    Accumulator narrowPhaseTests;
+    Accumulator collisions;
+    Accumulator timeOfImpact;
+    Accumulator sleeping;
+    Accumulator solverColors;
+
+    Accumulator arenaAllocated;
+    Accumulator arenaAllocatedSize;
+    Accumulator arenaAllocatedCount;
+};
+
+void writeTimes(std::ostream& out, const char* name, const Accumulator& acc, double cpuTimerFreq, bool last = false)
+{
+    const auto toMs = [cpuTimerFreq](double ticks) { return ticks / cpuTimerFreq * 1000.0; };
+
+    out << "      \"" << name << "\": {"
+        << "\"totalMs\": " << toMs(static_cast<double>(acc.total))
+        << ", \"meanMs\": " << toMs(acc.mean())
+        << ", \"minMs\": " << toMs(static_cast<double>(acc.min))
+        << ", \"maxMs\": " << toMs(static_cast<double>(acc.max))
+        << "}" << (last ? "" : ",") << "\n";
+}
+
+void writeCounts(std::ostream& out, const char* name, const Accumulator& acc, bool last = false)
+{
+    out << "      \"" << name << "\": {"
+        << "\"mean\": " << acc.mean()
+        << ", \"min\": " << acc.min
+        << ", \"max\": " << acc.max
+        << "}" << (last ? "" : ",") << "\n";
+}
+
+void writeReport(std::ostream& out, const Options& options, ngn::BroadphaseType broadphase, const Scenario& scenario,
+                 const ngn::MemoryArena& arena, uint32_t threadCount, const Results& results)
+{
+    const auto cpuTimerFreq = static_cast<double>(ngn::instrumentation::calcCpuTimerFreq());
+
+    out << std::fixed << std::setprecision(4);
+
+    out << "{\n";
+    out << "  \"scenario\": \"" << scenarioTypeName(options.scenarioConfig.type) << "\",\n";
+    out << "  \"config\": {"
+        << "\"broadphase\": \"" << broadphaseTypeName(broadphase) << "\""
+        << ", \"gridCellSize\": " << options.gridCellSize
+        << ", \"solverIterations\": " << options.solverIterations
+        << ", \"warmStarting\": " << (options.noWarmStarting ? "false" : "true")
+        << ", \"bodies\": " << options.scenarioConfig.bodyCount
+        << ", \"mazeSize\": " << options.scenarioConfig.mazeSize
+        << ", \"seed\": " << options.scenarioConfig.seed
+        << ", \"frames\": " << options.frames
+        << ", \"warmupFrames\": " << options.warmupFrames
+        << ", \"deltaTime\": " << options.deltaTime
+        << ", \"threads\": " << threadCount
+        << "},\n";
+    out << "  \"bodies\": {"
+        << "\"static\": " << scenario.staticBodyCount()
+        << ", \"dynamic\": " << scenario.dynamicBodyCount()
+        << "},\n";
+    out << "  \"cpuTimerFreq\": " << std::setprecision(0) << cpuTimerFreq << std::setprecision(4) << ",\n";
+
+    out << "  \"stages\": {\n";
+    writeTimes(out, "updateActive", results.updateActive, cpuTimerFreq);
+    writeTimes(out, "integrate", results.integrate, cpuTimerFreq);
+    writeTimes(out, "updateTree", results.updateTree, cpuTimerFreq);
+    writeTimes(out, "findPossibleCollisions", results.findPossibleCollisions, cpuTimerFreq);
+    writeTimes(out, "findActualCollsions", results.findActualCollisions, cpuTimerFreq);
+    writeTimes(out, "resolveCollisions", results.resolveCollisions, cpuTimerFreq);
+    writeTimes(out, "updateSleep", results.updateSleep, cpuTimerFreq);
+    writeTimes(out, "total", results.total, cpuTimerFreq, true);
+    out << "  },\n";
+
+    out << "  \"pairs\": {\n";
+    writeCounts(out, "moved", results.moved);
+    writeCounts(out, "possibleCollisions", results.possibleCollisions);
+    writeCounts(out, "narrowPhaseTests", results.narrowPhaseTests);
+    writeCounts(out, "collisions", results.collisions);
+    writeCounts(out, "timeOfImpact", results.timeOfImpact, true);
+    out << "  },\n";
+
+    out << "  \"solver\": {\n";
+    writeCounts(out, "colors", results.solverColors, true);
+    out << "  },\n";
+
+    out << "  \"sleep\": {\n";
+    writeCounts(out, "sleeping", results.sleeping, true);
+    out << "  },\n";
+
+    out << "  \"frameArena\": {\n";
+    out << "      \"capacity\": " << arena.capacity() << ",\n";
+    writeCounts(out, "allocated", results.arenaAllocated);
+    writeCounts(out, "allocatedSize", results.arenaAllocatedSize);
+    writeCounts(out, "allocatedCount", results.arenaAllocatedCount, true);
+    out << "  }\n";
+    out << "}";
+}
+
+// runs the scenario from scratch, the same seed gives the same scene for every broadphase
+void runBenchmark(std::ostream& out, const Options& options, ngn::BroadphaseType broadphase,
+                  ngn::MemoryArena& frameMemoryArena, ngn::JobSystem& jobSystem)
+{
+    entt::registry registry;
+
+    ngn::World world{&registry, &frameMemoryArena, &jobSystem};
+    world.setConfig({
+        .linearDamping = 1.0f,
+        .angularDamping = 1.0f,
+        .gravity{},
+        .broadphase = broadphase,
+        .gridCellSize = options.gridCellSize,
+        .solverIterations = options.solverIterations,
+        .warmStarting = !options.noWarmStarting,
+    });
+
+    Scenario scenario{&registry, &world, options.scenarioConfig};
+
+    Results results;
+
+    const auto frameCount = options.warmupFrames + options.frames;
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        frameMemoryArena.reset();
+
+        scenario.step(options.deltaTime);
+
+        world.update(options.deltaTime);
+
+        if (frame < options.warmupFrames)
+            continue;
+
+        const auto& stats = world.stats();
+
+        results.updateActive.add(stats.updateActiveTime);
+        results.integrate.add(stats.integrateTime);
+        results.updateTree.add(stats.updateTreeTime);
+        results.findPossibleCollisions.add(stats.findPossibleCollisionsTime);
+        results.findActualCollisions.add(stats.findActualCollisionsTime);
+        results.resolveCollisions.add(stats.resolveCollisionsTime);
+        results.updateSleep.add(stats.updateSleepTime);
+        results.total.add(stats.updateActiveTime + stats.integrateTime + stats.updateTreeTime +
+                          stats.findPossibleCollisionsTime + stats.findActualCollisionsTime +
+                          stats.resolveCollisionsTime + stats.updateSleepTime);
+
+        results.moved.add(stats.movedCount);
+        results.possibleCollisions.add(stats.possibleCollisionCount);
+        results.narrowPhaseTests.add(stats.narrowPhaseCount);
+        results.collisions.add(stats.collisionCount);
+        results.timeOfImpact.add(stats.timeOfImpactCount);
+        results.sleeping.add(stats.sleepingCount);
+        results.solverColors.add(stats.solverColorCount);
+
+        results.arenaAllocated.add(frameMemoryArena.allocated());
+        results.arenaAllocatedSize.add(frameMemoryArena.statAllocatedSize());
+        results.arenaAllocatedCount.add(frameMemoryArena.statAllocatedCount());
+    }
+
+    writeReport(out, options, broadphase, scenario, frameMemoryArena, jobSystem.threadCount(), results);
+}
+
+void runBenchmarks(std::ostream& out, const Options& options)
+{
+    ngn::MemoryArena frameMemoryArena{options.frameMemory};
+
+    ngn::JobSystem jobSystem{options.workers};
+
+    // a single report is written as is, several ones as an array
+    const auto single = options.broadphaseTypes.size() == 1;
+
+    if (!single)
+        out << "[\n";
+
+    for (std::size_t i = 0; i < options.broadphaseTypes.size(); i++)
+    {
+        if (i > 0)
+            out << ",\n";
+        runBenchmark(out, options, options.broadphaseTypes[i], frameMemoryArena, jobSystem);
+    }
+
+    out << (single ? "\n" : "\n]\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    int ret = parseCommandLine(argc, argv, options);
+    if (ret != 0)
+        return ret;
+
+    if (!options.outputFile.empty())
+    {
+        std::ofstream output{options.outputFile};
+        if (!output)
+        {
+            std::cerr << "Failed to open output file " << options.outputFile << std::endl;
+            return 1;
+        }
+        runBenchmarks(output, options);
+    }
+    else
+    {
+        runBenchmarks(std::cout, options);
+    }
+
+    return 0;
+}
@@ -0,0 +1,289 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "Scenarios.hpp"
+
+#include "CommonComponents.hpp"
+#include "phys/PhysComponents.hpp"
+#include "phys/World.hpp"
+#include <entt/entt.hpp>
+#include <glm/gtx/norm.hpp>
+
+namespace {
+
+// same layout as the maze level of the game
+constexpr float BlockSize = 128.0f;
+constexpr glm::vec2 MazeOffset{32, 32};
+constexpr float OuterWallWidth = 32.0f;
+
+constexpr float SteeringForce = 500.0f;
+constexpr float ShotSpeed = 400.0f;
+constexpr float ShotLifeTime = 3.0f;
+
+} // namespace
+
+bool parseScenarioType(std::string_view name, ScenarioType& type)
+{
+    if (name == "maze")
+        type = ScenarioType::Maze;
+    else if (name == "capsules")
+        type = ScenarioType::Capsules;
+    else if (name == "shots")
+        type = ScenarioType::Shots;
+    else
+        return false;
+    return true;
+}
+
+std::string_view scenarioTypeName(ScenarioType type)
+{
+    switch (type)
+    {
+        using enum ScenarioType;
+
+        case Maze:
+            return "maze";
+
+        case Capsules:
+            return "capsules";
+
+        case Shots:
+            return "shots";
+    }
+
+    return "unknown";
+}
+
+// *********************************************************************************************************************
+
+Scenario::Scenario(entt::registry* registry, ngn::World* world, const ScenarioConfig& config) :
+    registry_{registry},
+    world_{world},
+    config_{config},
+    random_{config.seed},
+    freeCells_{},
+    boundsMin_{},
+    boundsMax_{},
+    staticBodyCount_{},
+    dynamicBodyCount_{}
+{
+    switch (config_.type)
+    {
+        using enum ScenarioType;
+
+        case Maze:
+            createMaze(true);
+            createCircles(config_.bodyCount);
+            break;
+
+        case Capsules:
+            createMaze(false);
+            createCapsules(config_.bodyCount);
+            break;
+
+        case Shots:
+            createMaze(true);
+            createCircles(glm::max(1U, config_.bodyCount / 10));
+            createShots(config_.bodyCount);
+            break;
+    }
+}
+
+void Scenario::step(float deltaTime)
+{
+    std::uniform_real_distribution<float> spinDist{-20.0f, 20.0f};
+
+    for (auto& s : steered_)
+    {
+        auto [pos, vel, linForce, angForce] = registry_->get<
+                const ngn::Position,
+                const ngn::LinearVelocity,
+                ngn::LinearForce,
+                ngn::AngularForce>(s.entity);
+
+        if (glm::length2(s.target - pos.value) < BlockSize * BlockSize * 0.25f)
+        {
+            s.target = randomFreePosition();
+            s.spin = spinDist(random_);
+        }
+
+        const auto desiredVel = glm::normalize(s.target - pos.value) * SteeringForce;
+        linForce.value += desiredVel - vel.value;
+        angForce.value += s.spin;
+    }
+
+    for (auto& s : shots_)
+    {
+        s.lifeTime -= deltaTime;
+
+        const auto& pos = registry_->get<const ngn::Position>(s.entity);
+        const auto outside =
+                pos.value.x < boundsMin_.x || pos.value.y < boundsMin_.y ||
+                pos.value.x > boundsMax_.x || pos.value.y > boundsMax_.y;
+
+        if (s.lifeTime <= 0.0f || outside)
+            fireShot(s);
+    }
+}
+
+void Scenario::createMaze(bool innerWalls)
+{
+    const auto cellCount = config_.mazeSize * 2 + 1;
+    const float last = BlockSize * static_cast<float>(cellCount);
+
+    boundsMin_ = MazeOffset;
+    boundsMax_ = MazeOffset + last;
+
+    // outer walls
+
+    createWall(glm::vec2{-OuterWallWidth, -OuterWallWidth}, glm::vec2{last + OuterWallWidth, 0});
+    createWall(glm::vec2{-OuterWallWidth, last}, glm::vec2{last + OuterWallWidth, last + OuterWallWidth});
+    createWall(glm::vec2{-OuterWallWidth, 0}, glm::vec2{0, last});
+    createWall(glm::vec2{last, 0}, glm::vec2{last + OuterWallWidth, last});
+
+    // inner walls, every odd cell is a block
+
+    for (uint32_t y = 0; y < cellCount; y++)
+    {
+        for (uint32_t x = 0; x < cellCount; x++)
+        {
+            const auto x1 = static_cast<float>(x) * BlockSize;
+            const auto x2 = x1 + BlockSize;
+            const auto y1 = static_cast<float>(y) * BlockSize;
+            const auto y2 = y1 + BlockSize;
+
+            if (innerWalls && (x % 2) == 1 && (y % 2) == 1)
+            {
+                createWall(glm::vec2{x1, y1}, glm::vec2{x2, y2});
+            }
+            else
+            {
+                freeCells_.push_back(MazeOffset + glm::vec2{x1, y1} + BlockSize / 2.0f);
+            }
+        }
+    }
+}
+
+void Scenario::createWall(const glm::vec2& min, const glm::vec2& max)
+{
+    ngn::BodyCreateInfo createInfo;
+    createInfo.restitution = 1.5f;
+    createInfo.invMass = 0;
+    createInfo.dynamic = false;
+
+    const auto entity = registry_->create();
+    world_->createBody(entity, createInfo, ngn::Shape{
+        ngn::Box{.center = MazeOffset + (min + max) / 2.0f, .halfExtents = (max - min) / 2.0f}
+    });
+    registry_->emplace<ngn::ActiveTag>(entity);
+
+    staticBodyCount_++;
+}
+
+void Scenario::createCircles(uint32_t count)
+{
+    ngn::BodyCreateInfo createInfo;
+    createInfo.invMass = 1.f / 10.f;
+    createInfo.restitution = 1.5f;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const auto entity = createActor(randomFreePosition(), 0.0f);
+        world_->createBody(entity, createInfo, ngn::Shape{ngn::Circle{.center = {0, 2}, .radius = 17}});
+
+        steered_.push_back({.entity = entity, .target = randomFreePosition(), .spin = 0.0f});
+
+        dynamicBodyCount_++;
+    }
+}
+
+void Scenario::createCapsules(uint32_t count)
+{
+    std::uniform_real_distribution<float> angleDist{0.0f, glm::pi<float>() * 2.0f};
+
+    ngn::BodyCreateInfo createInfo;
+    createInfo.invMass = 1.f / 10.f;
+    createInfo.restitution = 1.5f;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const auto entity = createActor(randomFreePosition(), angleDist(random_));
+        world_->createBody(entity, createInfo, ngn::Shape{
+            ngn::Capsule{.start = {0, -20}, .end = {0, 20}, .radius = 10}
+        });
+
+        steered_.push_back({.entity = entity, .target = randomFreePosition(), .spin = 0.0f});
+
+        dynamicBodyCount_++;
+    }
+}
+
+void Scenario::createShots(uint32_t count)
+{
+    ngn::BodyCreateInfo createInfo;
+    createInfo.invMass = 100000.0f;
+    createInfo.restitution = 0.0f;
+    createInfo.friction = 0.001f;
+    createInfo.sensor = true;
+    createInfo.useForce = false;
+    createInfo.fastMoving = true;
+
+    std::uniform_real_distribution<float> lifeTimeDist{0.0f, ShotLifeTime};
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const auto entity = createActor(randomFreePosition(), 0.0f);
+        world_->createBody(entity, createInfo, ngn::Shape{ngn::Circle{.center = {0, 2}, .radius = 2}});
+
+        auto& shot = shots_.emplace_back(Shot{.entity = entity, .lifeTime = 0.0f});
+        fireShot(shot);
+        shot.lifeTime = lifeTimeDist(random_);
+
+        dynamicBodyCount_++;
+    }
+}
+
+entt::entity Scenario::createActor(const glm::vec2& pos, float rot)
+{
+    const auto entity = registry_->create();
+
+    registry_->emplace<ngn::Position>(entity, pos);
+
+    auto& rotation = registry_->emplace<ngn::Rotation>(entity, glm::vec2{1, 0}, rot);
+    rotation.update();
+
+    registry_->emplace<ngn::Scale>(entity, glm::vec2{1, 1});
+
+    registry_->emplace<ngn::ActiveTag>(entity);
+
+    return entity;
+}
+
+glm::vec2 Scenario::randomFreePosition()
+{
+    assert(!freeCells_.empty());
+
+    std::uniform_int_distribution<std::size_t> cellDist{0, freeCells_.size() - 1};
+    std::uniform_real_distribution<float> jitterDist{-BlockSize * 0.3f, BlockSize * 0.3f};
+
+    const auto& cell = freeCells_[cellDist(random_)];
+    return cell + glm::vec2{jitterDist(random_), jitterDist(random_)};
+}
+
+void Scenario::fireShot(Shot& shot)
+{
+    std::uniform_real_distribution<float> angleDist{0.0f, glm::pi<float>() * 2.0f};
+
+    auto [pos, rot, vel] = registry_->get<ngn::Position, ngn::Rotation, ngn::LinearVelocity>(shot.entity);
+
+    pos.value = randomFreePosition();
+
+    rot.angle = angleDist(random_);
+    rot.update();
+
+    vel.value = -rot.dir * ShotSpeed;
+
+    shot.lifeTime = ShotLifeTime;
+
+    world_->markTransformChanged(shot.entity);
+}
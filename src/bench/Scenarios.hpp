@@ -0,0 +1,91 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Macros.hpp"
+#include <entt/fwd.hpp>
+#include <glm/glm.hpp>
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace ngn {
+class World;
+} // namespace ngn
+
+enum class ScenarioType : uint32_t
+{
+    Maze,
+    Capsules,
+    Shots,
+};
+
+bool parseScenarioType(std::string_view name, ScenarioType& type);
+std::string_view scenarioTypeName(ScenarioType type);
+
+class ScenarioConfig
+{
+public:
+    ScenarioType type{ScenarioType::Maze};
+    uint32_t bodyCount{500};
+    uint32_t mazeSize{10};
+    uint32_t seed{1};
+};
+
+class Scenario
+{
+public:
+    Scenario(entt::registry* registry, ngn::World* world, const ScenarioConfig& config);
+
+    // called once per frame before the world update, drives the bodies like the game would
+    void step(float deltaTime);
+
+    uint32_t staticBodyCount() const { return staticBodyCount_; }
+    uint32_t dynamicBodyCount() const { return dynamicBodyCount_; }
+
+private:
+    class Steered
+    {
+    public:
+        entt::entity entity;
+        glm::vec2 target;
+        float spin;
+    };
+
+    class Shot
+    {
+    public:
+        entt::entity entity;
+        float lifeTime;
+    };
+
+private:
+    void createMaze(bool innerWalls);
+    void createWall(const glm::vec2& min, const glm::vec2& max);
+    void createCircles(uint32_t count);
+    void createCapsules(uint32_t count);
+    void createShots(uint32_t count);
+
+    entt::entity createActor(const glm::vec2& pos, float rot);
+    glm::vec2 randomFreePosition();
+    void fireShot(Shot& shot);
+
+private:
+    entt::registry* registry_;
+    ngn::World* world_;
+    ScenarioConfig config_;
+    std::mt19937 random_;
+
+    std::vector<glm::vec2> freeCells_;
+    glm::vec2 boundsMin_;
+    glm::vec2 boundsMax_;
+
+    std::vector<Steered> steered_;
+    std::vector<Shot> shots_;
+
+    uint32_t staticBodyCount_;
+    uint32_t dynamicBodyCount_;
+
+    NGN_DISABLE_COPY_MOVE(Scenario)
+};
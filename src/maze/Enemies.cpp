@@ -63,6 +63,7 @@ void Enemies::createEnemy(glm::vec2 pos, float angle)
         .body = {
             .invMass = 1.f / 10.f,
             .restitution = 1.5f,
+            .filter = {.categoryBits = CollisionCategory::Enemy},
         },
         .shape = ngn::Shape{ngn::Circle{.center = {0, 2}, .radius = 17}},
     };
@@ -93,7 +94,8 @@ void Enemies::update(float deltaTime)
             pos.value = {352, 352};
             rot.angle = 0.0f;
             rot.update();
-            registry_->emplace_or_replace<ngn::TransformChangedTag>(e);
+            world_->markTransformChanged(e);
+            gameStage_->app()->resetInterpolation(e);
         }
     }
 
@@ -163,16 +165,17 @@ void Enemies::update(float deltaTime)
 
 bool Enemies::testInSight(entt::entity player, entt::entity enemy, const ngn::Line& lineOfSight)
 {
-    const auto lineAABB = ngn::calculateAABB(lineOfSight);
-    bool blocking = false;
-    world_->query(lineAABB, [&blocking, player, enemy](auto e, auto)
-    {
-        blocking = e != player && e != enemy;
-        return !blocking;
-    });
-
     const auto diff2 = glm::length2(lineOfSight.end - lineOfSight.start);
-    const bool inSight = !blocking && diff2 > 65536.0f && diff2 < 262144.0f;
+    bool inSight = diff2 > 65536.0f && diff2 < 262144.0f;
+
+    if (inSight)
+    {
+        ngn::RayHit hit;
+        inSight = !world_->segmentCastAny(lineOfSight, hit, [player, enemy](entt::entity e)
+        {
+            return e != player && e != enemy;
+        });
+    }
 
 //#if defined(NGN_ENABLE_VISUAL_DEBUGGING)
 //    gameStage_->app()->debugRenderer()->drawArrow(lineOfSight.start, lineOfSight.end, 20.0f, inSight ? ngn::Colors::Green : ngn::Colors::Red);
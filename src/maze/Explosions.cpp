@@ -72,7 +72,7 @@ void Explosions::showExplosion(const glm::vec2& position, Type type)
     snd.setBuffer(gameStage_->resources().explosionSoundData);
     snd.play();
 
-    registry_->emplace_or_replace<ngn::TransformChangedTag>(entity);
+    world_->markTransformChanged(entity);
 
     gameStage_->app()->spriteAnimationHandler()->startAnimation(entity);
 }
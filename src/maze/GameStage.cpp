@@ -64,6 +64,7 @@ void GameStage::onActivate()
         .body = {
             .invMass = 1.f / 10.f,
             .restitution = 1.5f,
+            .filter = {.categoryBits = CollisionCategory::Player},
         },
         .shape = ngn::Shape{ngn::Circle{.center = {0, 2}, .radius = 17}},
     };
@@ -124,7 +125,7 @@ void GameStage::onKeyEvent(ngn::InputAction action, int key, ngn::InputMods mods
 #endif
 }
 
-void GameStage::onUpdate(float deltaTime)
+void GameStage::onFixedUpdate(float deltaTime)
 {
     handlePlayerInput(deltaTime);
 
@@ -135,10 +136,17 @@ void GameStage::onUpdate(float deltaTime)
     // ****************************************************
 
     shots_->update(deltaTime);
+}
 
-    // ****************************************************
+void GameStage::onUpdate(float deltaTime)
+{
+    NGN_UNUSED(deltaTime);
+
+    const auto alpha = app_->interpolationAlpha();
 
-    const auto playerPos = registry_->get<const ngn::Position>(playerGameState_.entity).value;
+    // follow the interpolated player, otherwise the whole scene stutters around it
+    const auto [pos, prev] = registry_->get<const ngn::Position, const ngn::PreviousTransform>(playerGameState_.entity);
+    const auto playerPos = glm::mix(prev.position, pos.value, alpha);
     playerViewBounds_ = {
         playerPos - halfViewSize_,
         playerPos + halfViewSize_,
@@ -154,7 +162,7 @@ void GameStage::onUpdate(float deltaTime)
 
     app_->spriteRenderer()->updateView(playerView);
 
-    app_->spriteRenderer()->renderSpriteComponents(registry_);
+    app_->spriteRenderer()->renderSpriteComponents(registry_, alpha);
 
     // ****************************************************
 
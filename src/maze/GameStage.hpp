@@ -51,6 +51,7 @@ public:
     void onKeyEvent(ngn::InputAction action, int key, ngn::InputMods mods) override;
 
     void onUpdate(float deltaTime) override;
+    void onFixedUpdate(float deltaTime) override;
 
     const Resources& resources() const;
 
@@ -4,6 +4,7 @@
 #include "Level.hpp"
 
 #include "Application.hpp"
+#include "MazeComponents.hpp"
 #include "gfx/GFXComponents.hpp"
 #include "phys/World.hpp"
 #include <entt/entt.hpp>
@@ -12,6 +13,7 @@ namespace {
 
 constexpr uint32_t MazeSize = 10;
 constexpr uint32_t BlockSize = 128;
+constexpr float OuterWallWidth = 32;
 
 } // namespace
 
@@ -36,9 +38,11 @@ void Level::createMaze()
     wallCreateInfo.restitution = 1.5f;
     wallCreateInfo.invMass = 0;
     wallCreateInfo.dynamic = false;
+    wallCreateInfo.filter.categoryBits = CollisionCategory::Wall;
 
-    constexpr auto outerWallCount = (MazeSize * 2 + 1) * 4;
-    constexpr auto innerWallCount = (MazeSize * MazeSize) * 4;
+    // one box per side of the outer ring and per inner block
+    constexpr auto outerWallCount = 4;
+    constexpr auto innerWallCount = MazeSize * MazeSize;
     const glm::vec2 offset{32, 32};
 
     walls_.resize(outerWallCount + innerWallCount);
@@ -47,29 +51,25 @@ void Level::createMaze()
     const float last = BlockSize * (MazeSize * 2 + 1);
 
     auto createWallBody = [reg = registry_, &wallCreateInfo, &offset, world]
-            (entt::entity entity, const glm::vec2& start, const glm::vec2& end)
+            (entt::entity entity, const glm::vec2& min, const glm::vec2& max)
     {
         world->createBody(entity, wallCreateInfo, ngn::Shape{
-            ngn::Line{.start = offset + start, .end = offset + end}
+            ngn::Box{.center = offset + (min + max) / 2.0f, .halfExtents = (max - min) / 2.0f}
         });
         reg->emplace<ngn::ActiveTag>(entity);
     };
 
-    // outer walls
+    // outer walls, outside of the play area below the outer sprites
 
-    for (uint32_t i = 0; i < MazeSize * 2 + 1; i++)
-    {
-        const auto start = i * BlockSize;
-        const auto end = start + BlockSize;
+    const float outer = last + OuterWallWidth;
 
-        createWallBody(walls_[i * 4 + 0], glm::vec2{start, 0}, glm::vec2{end, 0});
+    createWallBody(walls_[0], glm::vec2{-OuterWallWidth, -OuterWallWidth}, glm::vec2{outer, 0});
 
-        createWallBody(walls_[i * 4 + 1], glm::vec2{start, last}, glm::vec2{end, last});
+    createWallBody(walls_[1], glm::vec2{-OuterWallWidth, last}, glm::vec2{outer, outer});
 
-        createWallBody(walls_[i * 4 + 2], glm::vec2{0, start}, glm::vec2{0, end});
+    createWallBody(walls_[2], glm::vec2{-OuterWallWidth, 0}, glm::vec2{0, last});
 
-        createWallBody(walls_[i * 4 + 3], glm::vec2{last, start}, glm::vec2{last, end});
-    }
+    createWallBody(walls_[3], glm::vec2{last, 0}, glm::vec2{outer, last});
 
     // inner walls
 
@@ -77,20 +77,12 @@ void Level::createMaze()
     {
         for (uint32_t x = 0; x < MazeSize; x++)
         {
-            const auto i = outerWallCount + (y * MazeSize + x) * 4;
-
             const auto x1 = BlockSize + x * 2 * BlockSize;
             const auto x2 = x1 + BlockSize;
             const auto y1 = BlockSize + y * 2 * BlockSize;
             const auto y2 = y1 + BlockSize;
 
-            createWallBody(walls_[i + 0], glm::vec2{x1, y1}, glm::vec2{x2, y1});
-
-            createWallBody(walls_[i + 1], glm::vec2{x2, y1}, glm::vec2{x2, y2});
-
-            createWallBody(walls_[i + 2], glm::vec2{x2, y2}, glm::vec2{x1, y2});
-
-            createWallBody(walls_[i + 3], glm::vec2{x1, y2}, glm::vec2{x1, y1});
+            createWallBody(walls_[outerWallCount + y * MazeSize + x], glm::vec2{x1, y1}, glm::vec2{x2, y2});
         }
     }
 
@@ -2,9 +2,20 @@
 // SPDX-License-Identifier: MIT
 
 #include "MazeDelegate.hpp"
+#include <CLI/CLI.hpp>
 
-int main() {
-    MazeDelegate delegate{};
+int main(int argc, char** argv) {
+    MazeOptions options;
+
+    CLI::App cli{"Maze ][", "maze"};
+
+    auto* record = cli.add_option("--record", options.inputRecordFile, "Record the input of the session to this file");
+    cli.add_option("--replay", options.inputReplayFile, "Replay the input of a recorded session and quit at its end")
+            ->excludes(record);
+
+    CLI11_PARSE(cli, argc, argv);
+
+    MazeDelegate delegate{options};
 
     ngn::Application app{&delegate};
 
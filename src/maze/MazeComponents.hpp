@@ -12,6 +12,16 @@ enum class ActorType : uint32_t
     Shot,
 };
 
+// category bits of the collision filters, shots do not collide with each other
+namespace CollisionCategory {
+
+constexpr uint32_t Wall = 1 << 0;
+constexpr uint32_t Player = 1 << 1;
+constexpr uint32_t Enemy = 1 << 2;
+constexpr uint32_t Shot = 1 << 3;
+
+} // namespace CollisionCategory
+
 class PlayerTag
 {
 };
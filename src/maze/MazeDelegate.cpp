@@ -21,6 +21,11 @@ ngn::ApplicationConfig MazeDelegate::applicationConfig(ngn::Application* app)
 
         .requiredMemory = 100 * 1024 * 1024, // TODO st correct memory amount
 
+        .fixedUpdateRate = 60.0f,
+
+        .inputRecordFile = options_.inputRecordFile,
+        .inputReplayFile = options_.inputReplayFile,
+
         .spriteRenderer = true,
         .spriteBatchCount = 16384, // TODO set correct max sprite count
 
@@ -21,10 +21,17 @@ public:
     ngn::AudioBuffer* laserHitWallSoundData;
 };
 
+class MazeOptions
+{
+public:
+    std::string inputRecordFile;
+    std::string inputReplayFile;
+};
+
 class MazeDelegate : public ngn::ApplicationDelegate
 {
 public:
-    MazeDelegate() = default;
+    explicit MazeDelegate(const MazeOptions& options) : options_{options} { }
     ~MazeDelegate() override = default;
 
     ngn::ApplicationConfig applicationConfig(ngn::Application* app) override;
@@ -39,6 +46,7 @@ private:
     void loadAssets(ngn::Application* app);
 
 private:
+    MazeOptions options_;
     ngn::Application* app_;
     Resources resources_;
     // LoadingStage* loadingStage_;
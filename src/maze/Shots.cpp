@@ -28,7 +28,8 @@ Shots::Shots(GameStage* gameStage) :
     registry_{gameStage_->app()->registry()},
     world_{gameStage_->app()->world()}
 {
-    collisionCallback_ = world_->addCollisionListener<&Shots::handleCollision>(this);
+    hitListener_ = world_->addCollisionBatchListener<&Shots::handleHits, ShotTag, ngn::AnyBody>(
+            ngn::ContactEvent::Begin, this);
 }
 
 Shots::~Shots()
@@ -36,7 +37,7 @@ Shots::~Shots()
     auto view = registry_->view<ShotTag>();
     registry_->destroy(view.begin(), view.end());
 
-    collisionCallback_.release();
+    world_->removeCollisionBatchListener(hitListener_);
 }
 
 void Shots::fireLaser(const glm::vec2& position, float rotation, bool player)
@@ -61,6 +62,10 @@ void Shots::fireLaser(const glm::vec2& position, float rotation, bool player)
                 .friction = 0.001f,
                 .sensor = true,
                 .useForce = false,
+                .filter = {
+                    .categoryBits = CollisionCategory::Shot,
+                    .maskBits = CollisionCategory::Wall | CollisionCategory::Player | CollisionCategory::Enemy,
+                },
             },
             .shape = ngn::Shape{ngn::Circle{.center = {0, 2}, .radius = 2}},
             .active = false,
@@ -99,7 +104,8 @@ void Shots::fireLaser(const glm::vec2& position, float rotation, bool player)
 
     info.sourceType = player ? ActorType::Player : ActorType::Enemy;
 
-    registry_->emplace_or_replace<ngn::TransformChangedTag>(entity);
+    world_->markTransformChanged(entity);
+    gameStage_->app()->resetInterpolation(entity);
 }
 
 void Shots::update(float deltaTime)
@@ -114,25 +120,32 @@ void Shots::update(float deltaTime)
     }
 }
 
-void Shots::handleCollision(const ngn::Collision& collision)
+void Shots::handleHits(std::span<const ngn::Collision> hits)
 {
-    const auto shotA = registry_->any_of<ShotTag>(collision.pair.bodyA);
-    const auto shotB = registry_->any_of<ShotTag>(collision.pair.bodyB);
-
-    auto handleHit = [this](entt::entity shot, entt::entity otherBody)
+    // bodyA is the shot
+    for (const auto& hit : hits)
     {
+        const auto shot = hit.pair.bodyA;
+        const auto otherBody = hit.pair.bodyB;
+
+        // a shot hitting two bodies at once is only stopped by the first one
+        if (!registry_->all_of<ngn::ActiveTag>(shot))
+            continue;
+
         const auto sourceType = registry_->get<const ShotInfo>(shot).sourceType;
         const auto isEnemy = registry_->any_of<EnemyTag>(otherBody);
         const auto isPlayer = registry_->any_of<PlayerTag>(otherBody);
 
         if ((sourceType == ActorType::Player && isPlayer) || (sourceType == ActorType::Enemy && isEnemy))
-            return;
+            continue;
 
         registry_->remove<ngn::ActiveTag>(shot);
 
         if (isEnemy)
         {
-            gameStage_->killEnemy(otherBody);
+            // the enemy might have been hit by another shot already
+            if (registry_->all_of<ngn::ActiveTag>(otherBody))
+                gameStage_->killEnemy(otherBody);
         }
         else if (isPlayer)
         {
@@ -143,10 +156,5 @@ void Shots::handleCollision(const ngn::Collision& collision)
             const auto& snd = registry_->get<HitWallSound>(shot);
             snd.play();
         }
-    };
-
-    if (shotA)
-        handleHit(collision.pair.bodyA, collision.pair.bodyB);
-    else if (shotB)
-        handleHit(collision.pair.bodyB, collision.pair.bodyA);
+    }
 }
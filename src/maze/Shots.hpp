@@ -21,13 +21,13 @@ public:
     void update(float deltaTime);
 
 private:
-    void handleCollision(const ngn::Collision& collision);
+    void handleHits(std::span<const ngn::Collision> hits);
 
 private:
     GameStage* gameStage_;
     entt::registry* registry_;
     ngn::World* world_;
-    entt::connection collisionCallback_;
+    uint32_t hitListener_;
 
     NGN_DISABLE_COPY_MOVE(Shots)
 };
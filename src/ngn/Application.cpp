@@ -3,7 +3,9 @@
 
 #include "Application.hpp"
 
+#include "InputRecording.hpp"
 #include "Instrumentation.hpp"
+#include "JobSystem.hpp"
 #include "Timer.hpp"
 #include "audio/Audio.hpp"
 #include "gfx/CommandBuffer.hpp"
@@ -19,6 +21,7 @@
 #include <GLFW/glfw3.h>
 #include <entt/entt.hpp>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
 
 #if defined(NGN_ENABLE_VISUAL_DEBUGGING)
@@ -47,6 +50,7 @@ Application::Application(ApplicationDelegate* delegate) :
     window_{},
     renderer_{},
     frameMemoryArena_{},
+    jobSystem_{},
     spriteRenderer_{},
     spriteAnimationHandler_{},
     uiRenderer_{},
@@ -54,9 +58,15 @@ Application::Application(ApplicationDelegate* delegate) :
     debugRenderer_{},
 #endif
     audio_{},
+    inputRecorder_{},
+    inputReplay_{},
     world_{},
     stage_{},
     nextStage_{},
+    fixedDeltaTime_{},
+    maxFixedUpdates_{},
+    accumulatedTime_{},
+    interpolationAlpha_{1.0f},
     exitCode_{0}
 {
     assert(!gApplication);
@@ -74,6 +84,12 @@ Application::Application(ApplicationDelegate* delegate) :
 
     const auto config = delegate->applicationConfig(this);
 
+    if (config.fixedUpdateRate > 0.0f)
+    {
+        fixedDeltaTime_ = 1.0f / config.fixedUpdateRate;
+        maxFixedUpdates_ = std::max(config.maxFixedUpdates, 1U);
+    }
+
     window_ = glfwCreateWindow(config.windowWidth, config.windowHeight, config.windowTitle, nullptr, nullptr);
     if (!window_)
         throw std::runtime_error("Failed to create window");
@@ -84,7 +100,11 @@ Application::Application(ApplicationDelegate* delegate) :
 
     registry_ = new entt::registry{};
 
-    world_ = new World{this};
+    frameMemoryArena_ = new MemoryArena{config.requiredMemory};
+
+    jobSystem_ = new JobSystem{config.jobWorkerCount};
+
+    world_ = new World{registry_, frameMemoryArena_, jobSystem_};
 
     glfwSetFramebufferSizeCallback(window_, framebufferResizeCallback);
     glfwSetKeyCallback(window_, keyCallback);
@@ -111,7 +131,10 @@ Application::Application(ApplicationDelegate* delegate) :
     if (config.audio)
         audio_ = new Audio{};
 
-    frameMemoryArena_ = new MemoryArena{config.requiredMemory};
+    if (!config.inputReplayFile.empty())
+        inputReplay_ = new InputReplay{config.inputReplayFile};
+    else if (!config.inputRecordFile.empty())
+        inputRecorder_ = new InputRecorder{config.inputRecordFile};
 
     stage_ = delegate_->onInit(this);
     if (!stage_)
@@ -127,7 +150,9 @@ Application::~Application()
 
     delegate_->onDone(this);
 
-    delete frameMemoryArena_;
+    delete inputReplay_;
+
+    delete inputRecorder_;
 
     delete audio_;
 
@@ -143,6 +168,10 @@ Application::~Application()
 
     delete world_;
 
+    delete jobSystem_;
+
+    delete frameMemoryArena_;
+
     delete registry_;
 
     delete renderer_;
@@ -188,16 +217,33 @@ entt::entity Application::createActor(glm::vec2 pos, float rot, glm::vec2 sca, b
     if (active)
         registry_->emplace<ActiveTag>(entity);
 
+    if (fixedDeltaTime_ > 0.0f)
+        registry_->emplace<PreviousTransform>(entity, pos, rot);
+
     return entity;
 }
 
+void Application::resetInterpolation(entt::entity entity)
+{
+    auto [previous, pos, rot] = registry_->try_get<PreviousTransform, const Position, const Rotation>(entity);
+    if (!previous)
+        return;
+
+    previous->position = pos->value;
+    previous->angle = rot->angle;
+}
+
 bool Application::isKeyDown(int key) const
 {
+    if (inputReplay_)
+        return inputReplay_->isKeyDown(key);
     return glfwGetKey(window_, key) == GLFW_PRESS;
 }
 
 bool Application::isKeyUp(int key) const
 {
+    if (inputReplay_)
+        return !inputReplay_->isKeyDown(key);
     return glfwGetKey(window_, key) == GLFW_RELEASE;
 }
 
@@ -225,14 +271,18 @@ int Application::exec()
         glfwPollEvents();
 
         const auto tick = fpsTimer.elapsed(true);
-        const auto deltaTime = Duration<float>{tick.second}.count();
+        auto deltaTime = Duration<float>{tick.second}.count();
+
+        if (!processInput(deltaTime))
+            break;
 
         update(deltaTime);
 
         draw(deltaTime);
 
 #if defined(NGN_ENABLE_INSTRUMENTATION)
-        if (const auto stat = statTimer.elapsed(); frameCount >= 5000.0)
+        // a replay runs to its end
+        if (const auto stat = statTimer.elapsed(); !inputReplay_ && frameCount >= 5000.0)
 #else
         if (const auto stat = statTimer.elapsed(Duration<double>{5.0}); stat.first)
 #endif
@@ -266,18 +316,82 @@ int Application::exec()
     return exitCode_;
 }
 
+bool Application::processInput(float& deltaTime)
+{
+    if (inputRecorder_)
+    {
+        inputRecorder_->endFrame(deltaTime);
+    }
+    else if (inputReplay_)
+    {
+        if (!inputReplay_->nextFrame(deltaTime))
+        {
+            log::info("Input replay finished");
+            return false;
+        }
+
+        for (const auto& event : inputReplay_->events())
+            stage_->onKeyEvent(event.action, event.key, event.mods);
+    }
+
+    return true;
+}
+
 void Application::update(float deltaTime)
 {
     NGN_INSTRUMENT_FUNCTION();
 
-    stage_->onUpdate(deltaTime);
+    if (fixedDeltaTime_ > 0.0f)
+    {
+        fixedUpdate(deltaTime);
+
+        stage_->onUpdate(deltaTime);
+    }
+    else
+    {
+        stage_->onUpdate(deltaTime);
 
-    world_->update(deltaTime);
+        world_->update(deltaTime);
+    }
 
     if (spriteAnimationHandler_)
         spriteAnimationHandler_->update(deltaTime);
 }
 
+void Application::fixedUpdate(float deltaTime)
+{
+    accumulatedTime_ += deltaTime;
+
+    uint32_t updates{};
+    while (accumulatedTime_ >= fixedDeltaTime_ && updates < maxFixedUpdates_)
+    {
+        storePreviousTransforms();
+
+        stage_->onFixedUpdate(fixedDeltaTime_);
+
+        world_->update(fixedDeltaTime_);
+
+        accumulatedTime_ -= fixedDeltaTime_;
+        updates++;
+    }
+
+    // the world could not keep up, let it fall behind instead of running more updates every frame
+    if (accumulatedTime_ >= fixedDeltaTime_)
+        accumulatedTime_ = std::fmod(accumulatedTime_, fixedDeltaTime_);
+
+    interpolationAlpha_ = accumulatedTime_ / fixedDeltaTime_;
+}
+
+void Application::storePreviousTransforms()
+{
+    auto view = registry_->view<PreviousTransform, const Position, const Rotation>();
+    for (auto [e, previous, pos, rot] : view.each())
+    {
+        previous.position = pos.value;
+        previous.angle = rot.angle;
+    }
+}
+
 void Application::draw(float deltaTime)
 {
     NGN_UNUSED(deltaTime);
@@ -322,6 +436,13 @@ void Application::keyCallback(GLFWwindow* window, int key, int scancode, int act
 
     auto* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
 
+    // only the recorded events are delivered during a replay
+    if (app->inputReplay_)
+        return;
+
+    if (app->inputRecorder_)
+        app->inputRecorder_->addEvent({.key = key, .action = toInputAction(action), .mods = toInputMods(mods)});
+
     app->stage_->onKeyEvent(toInputAction(action), key, toInputMods(mods));
 }
 
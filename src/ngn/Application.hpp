@@ -9,6 +9,7 @@
 #include "gfx/Renderer.hpp"
 #include "Macros.hpp"
 #include <entt/fwd.hpp>
+#include <string>
 
 struct GLFWwindow;
 
@@ -17,6 +18,9 @@ namespace ngn {
 class Application;
 class Audio;
 class FontMaker;
+class InputRecorder;
+class InputReplay;
+class JobSystem;
 class MemoryArena;
 class SpriteRenderer;
 class SpriteAnimator;
@@ -38,6 +42,20 @@ public:
 
     std::size_t requiredMemory{};
 
+    // number of job worker threads besides the main thread, -1 starts one per additional hardware thread
+    int32_t jobWorkerCount{-1};
+
+    // world updates per second, 0 updates the world once per frame with the frame time
+    float fixedUpdateRate{};
+    // most fixed updates run per frame, the time left beyond them is dropped so a hitch does not pile up steps
+    uint32_t maxFixedUpdates{4};
+
+    // writes the key events and frame times of the session to this file
+    std::string inputRecordFile;
+    // Plays the key events and frame times of a recorded session instead of the live input and the clock, the
+    // application quits at its end. The world runs the same updates on every replay independent of the frame rate.
+    std::string inputReplayFile;
+
     bool spriteRenderer{};
     uint32_t spriteBatchCount{};
 
@@ -64,7 +82,11 @@ public:
 
     virtual void onWindowResize(const glm::vec2& windowSize) { NGN_UNUSED(windowSize); }
     virtual void onKeyEvent(InputAction action, int key, InputMods mods) { NGN_UNUSED(action); NGN_UNUSED(key); NGN_UNUSED(mods); }
+    // Called once per frame. With a fixed update rate it is called after the world updates of the frame and should
+    // only render, see Application::interpolationAlpha().
     virtual void onUpdate(float deltaTime) { NGN_UNUSED(deltaTime); }
+    // called before every world update when running with a fixed update rate
+    virtual void onFixedUpdate(float deltaTime) { NGN_UNUSED(deltaTime); }
 };
 
 // *********************************************************************************************************************
@@ -92,9 +114,13 @@ public:
 
     Renderer* renderer() const { return renderer_; }
     MemoryArena* frameMemoryArena() const { return frameMemoryArena_; }
+    JobSystem* jobSystem() const { return jobSystem_; }
     entt::registry* registry() const { return registry_; }
     World* world() const { return world_; }
 
+    // fraction of a fixed update the frame time is ahead of the world, to interpolate from PreviousTransform
+    float interpolationAlpha() const { return interpolationAlpha_; }
+
     SpriteRenderer* spriteRenderer() const { return spriteRenderer_; }
     SpriteAnimator* spriteAnimationHandler() const { return spriteAnimationHandler_; }
     UiRenderer* uiRenderer() const { return uiRenderer_; }
@@ -114,12 +140,19 @@ public:
 
     entt::entity createActor(glm::vec2 pos, float rot = 0.0f, glm::vec2 sca = {1, 1}, bool active = true);
 
+    // Must be called after an actor was teleported, so rendering does not interpolate across the jump.
+    void resetInterpolation(entt::entity entity);
+
     bool isKeyDown(int key) const;
     bool isKeyUp(int key) const;
 
     int exec();
 private:
+    // records or replaces the input and delta time of the frame, false at the end of a replay
+    bool processInput(float& deltaTime);
     void update(float deltaTime);
+    void fixedUpdate(float deltaTime);
+    void storePreviousTransforms();
     void draw(float deltaTime);
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
@@ -130,6 +163,7 @@ private:
     GLFWwindow* window_;
     Renderer* renderer_;
     MemoryArena* frameMemoryArena_;
+    JobSystem* jobSystem_;
 
     SpriteRenderer* spriteRenderer_;
     SpriteAnimator* spriteAnimationHandler_;
@@ -141,12 +175,20 @@ private:
 
     Audio* audio_;
 
+    InputRecorder* inputRecorder_;
+    InputReplay* inputReplay_;
+
     entt::registry* registry_;
     World* world_;
 
     ApplicationStage* stage_;
     ApplicationStage* nextStage_;
 
+    float fixedDeltaTime_;
+    uint32_t maxFixedUpdates_;
+    float accumulatedTime_;
+    float interpolationAlpha_;
+
     int exitCode_;
 
     NGN_DISABLE_COPY_MOVE(Application)
@@ -0,0 +1,57 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Macros.hpp"
+#include <entt/entt.hpp>
+#include <span>
+#include <vector>
+
+namespace ngn {
+
+// Entities marked since the last clear(), kept apart from the registry so marking adds or removes no components.
+// An array indexed by the entity index holds the marked version of each entity, so every entity is listed only once.
+class ChangeSet
+{
+public:
+    ChangeSet() = default;
+
+    void mark(entt::entity entity)
+    {
+        const auto index = entt::to_entity(entity);
+        if (index >= marked_.size())
+            marked_.resize(std::max<std::size_t>(index + 1, marked_.size() * 2), entt::null);
+
+        if (marked_[index] == entity)
+            return;
+
+        marked_[index] = entity;
+        entities_.push_back(entity);
+    }
+
+    bool contains(entt::entity entity) const
+    {
+        const auto index = entt::to_entity(entity);
+        return index < marked_.size() && marked_[index] == entity;
+    }
+
+    // in the order they were marked, entities destroyed in between are still listed
+    std::span<const entt::entity> entities() const { return entities_; }
+    bool empty() const { return entities_.empty(); }
+
+    void clear()
+    {
+        for (const auto entity : entities_)
+            marked_[entt::to_entity(entity)] = entt::null;
+        entities_.clear();
+    }
+
+private:
+    std::vector<entt::entity> marked_;
+    std::vector<entt::entity> entities_;
+
+    NGN_DISABLE_COPY_MOVE(ChangeSet)
+};
+
+} // namespace ngn
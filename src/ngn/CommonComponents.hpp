@@ -35,4 +35,13 @@ public:
     glm::vec2 value{1, 1};
 };
 
+// Transform before the last fixed update step, rendering interpolates from it to the current one. Only actors created
+// while the application runs with a fixed update rate have it.
+class PreviousTransform
+{
+public:
+    glm::vec2 position{};
+    float angle{};
+};
+
 } // namespace
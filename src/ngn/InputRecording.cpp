@@ -0,0 +1,126 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "InputRecording.hpp"
+
+#include <stdexcept>
+
+namespace ngn {
+
+namespace {
+
+constexpr uint32_t FileMagic = 0x49'4E'47'4E; // "NGNI"
+constexpr uint32_t FileVersion = 1;
+
+class FrameHeader
+{
+public:
+    float deltaTime;
+    uint32_t eventCount;
+};
+
+class EventRecord
+{
+public:
+    int16_t key;
+    uint8_t action;
+    uint8_t mods;
+};
+
+static_assert(sizeof(EventRecord) == 4);
+
+template<typename T>
+void write(std::ofstream& file, const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read(std::ifstream& file, T& value)
+{
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+} // namespace
+
+// *********************************************************************************************************************
+
+InputRecorder::InputRecorder(const std::string& fileName) :
+    file_{fileName, std::ios::binary | std::ios::trunc}
+{
+    if (!file_)
+        throw std::runtime_error("Failed to open input recording " + fileName);
+
+    write(file_, FileMagic);
+    write(file_, FileVersion);
+}
+
+void InputRecorder::addEvent(const InputEvent& event)
+{
+    events_.push_back(event);
+}
+
+void InputRecorder::endFrame(float deltaTime)
+{
+    write(file_, FrameHeader{.deltaTime = deltaTime, .eventCount = static_cast<uint32_t>(events_.size())});
+
+    for (const auto& event : events_)
+    {
+        write(file_, EventRecord{
+            .key = static_cast<int16_t>(event.key),
+            .action = static_cast<uint8_t>(event.action),
+            .mods = static_cast<uint8_t>(event.mods),
+        });
+    }
+
+    events_.clear();
+}
+
+// *********************************************************************************************************************
+
+InputReplay::InputReplay(const std::string& fileName) :
+    file_{fileName, std::ios::binary}
+{
+    uint32_t magic{};
+    uint32_t version{};
+    if (!read(file_, magic) || !read(file_, version) || magic != FileMagic)
+        throw std::runtime_error("Not an input recording " + fileName);
+    if (version != FileVersion)
+        throw std::runtime_error("Unsupported input recording version " + std::to_string(version));
+}
+
+bool InputReplay::nextFrame(float& deltaTime)
+{
+    events_.clear();
+
+    FrameHeader header;
+    if (!read(file_, header))
+        return false;
+
+    for (uint32_t i = 0; i < header.eventCount; i++)
+    {
+        EventRecord record;
+        if (!read(file_, record))
+            return false;
+
+        const InputEvent event{
+            .key = record.key,
+            .action = static_cast<InputAction>(record.action),
+            .mods = static_cast<InputMods>(record.mods),
+        };
+        events_.push_back(event);
+
+        if (event.key >= 0 && static_cast<std::size_t>(event.key) < keysDown_.size())
+            keysDown_[static_cast<std::size_t>(event.key)] = event.action != InputAction::Release;
+    }
+
+    deltaTime = header.deltaTime;
+    return true;
+}
+
+bool InputReplay::isKeyDown(int key) const
+{
+    return key >= 0 && static_cast<std::size_t>(key) < keysDown_.size() && keysDown_[static_cast<std::size_t>(key)];
+}
+
+} // namespace ngn
@@ -0,0 +1,62 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Input.hpp"
+#include "Macros.hpp"
+#include <bitset>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ngn {
+
+class InputEvent
+{
+public:
+    int32_t key;
+    InputAction action;
+    InputMods mods;
+};
+
+// Writes the key events and the delta time of every frame to a binary file. Per frame the delta time and the number
+// of events is stored, followed by four bytes per event.
+class InputRecorder
+{
+public:
+    explicit InputRecorder(const std::string& fileName);
+
+    void addEvent(const InputEvent& event);
+    void endFrame(float deltaTime);
+
+private:
+    std::ofstream file_;
+    std::vector<InputEvent> events_;
+
+    NGN_DISABLE_COPY_MOVE(InputRecorder)
+};
+
+// Reads a file written by InputRecorder frame by frame and keeps the key state the replayed events result in.
+class InputReplay
+{
+public:
+    explicit InputReplay(const std::string& fileName);
+
+    // false at the end of the recording
+    bool nextFrame(float& deltaTime);
+
+    // events of the current frame
+    const std::vector<InputEvent>& events() const { return events_; }
+
+    bool isKeyDown(int key) const;
+
+private:
+    std::ifstream file_;
+    std::vector<InputEvent> events_;
+    std::bitset<GLFW_KEY_LAST + 1> keysDown_;
+
+    NGN_DISABLE_COPY_MOVE(InputReplay)
+};
+
+} // namespace ngn
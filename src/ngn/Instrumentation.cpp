@@ -3,6 +3,8 @@
 
 #include "Instrumentation.hpp"
 
+#include <cstring>
+
 namespace ngn::instrumentation {
 
 uint64_t calcCpuTimerFreq()
@@ -37,6 +39,11 @@ uint64_t calcCpuTimerFreq()
 
 namespace {
 
+constexpr std::size_t MaxValueInfos = 64;
+
+ValueInfo gValueInfos[MaxValueInfos];
+std::size_t gValueInfoCount{};
+
 struct DoubleFormatter
 {
     int width;
@@ -89,6 +96,38 @@ void stop()
     gGlobalTimerInfo->name = "[total]";
 }
 
+void recordValue(const char* name, double value)
+{
+    ValueInfo* info{};
+
+    for (std::size_t i = 0; i < gValueInfoCount; i++)
+    {
+        if (gValueInfos[i].name == name || std::strcmp(gValueInfos[i].name, name) == 0)
+        {
+            info = &gValueInfos[i];
+            break;
+        }
+    }
+
+    if (!info)
+    {
+        if (gValueInfoCount == MaxValueInfos)
+            return;
+
+        info = &gValueInfos[gValueInfoCount++];
+        info->name = name;
+        info->first = value;
+        info->min = value;
+        info->max = value;
+    }
+
+    info->last = value;
+    info->min = std::min(info->min, value);
+    info->max = std::max(info->max, value);
+    info->sum += value;
+    info->sampleCount++;
+}
+
 void dumpTimerInfos(std::ostream& output)
 {
     const auto cpuTimerFreq = static_cast<double>(calcCpuTimerFreq());
@@ -154,6 +193,27 @@ void dumpTimerInfos(std::ostream& output)
 
         chain = chain->parent;
     }
+
+    for (std::size_t i = 0; i < gValueInfoCount; i++)
+    {
+        const auto& info = gValueInfos[i];
+
+        constexpr int nameLen = 25;
+        std::string name{info.name};
+        if (name.length() > nameLen)
+            name.erase(0, name.length() - nameLen);
+
+        const auto mean = info.sum / static_cast<double>(info.sampleCount);
+
+        output << std::setw(nameLen) << name
+               << ": samples: " << std::setw(9) << info.sampleCount
+               << ", first: " << dbl(12, 4) << info.first
+               << ", last: " << dbl(12, 4) << info.last
+               << ", min: " << dbl(12, 4) << info.min
+               << ", max: " << dbl(12, 4) << info.max
+               << ", mean: " << dbl(12, 4) << mean
+               << "\n";
+    }
 }
 
 #endif
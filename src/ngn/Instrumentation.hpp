@@ -85,6 +85,17 @@ struct TimerInfo
 
 extern TimerInfo* gActualTimerInfo;
 
+struct ValueInfo
+{
+    double first{};
+    double last{};
+    double min{};
+    double max{};
+    double sum{};
+    uint64_t sampleCount{};
+    const char* name{};
+};
+
 struct TimerInfoChain
 {
     TimerInfoChain(const char* n, std::span<TimerInfo> ti);
@@ -153,6 +164,9 @@ void start();
 void stop();
 void dumpTimerInfos(std::ostream &output);
 
+// Adds a sample of a named value, the dump shows how it developed over the run. Main thread only.
+void recordValue(const char* name, double value);
+
 static TimerInfo* timerInfos(uint64_t id);
 
 #define NGN_INSTRUMENTATION_EPILOG(name) \
@@ -191,6 +205,9 @@ static TimerInfo* timerInfos(uint64_t id);
 #define NGN_SCOPETIMER_STOP(var) \
     _scopeTimer_##var.stop();
 
+#define NGN_INSTRUMENT_VALUE(name, value) \
+    ::ngn::instrumentation::recordValue(name, static_cast<double>(value))
+
 #else
 
 #define NGN_INSTRUMENTATION_EPILOG(name)
@@ -208,6 +225,8 @@ static TimerInfo* timerInfos(uint64_t id);
 
 #define NGN_SCOPETIMER_STOP(var)
 
+#define NGN_INSTRUMENT_VALUE(name, value)
+
 #endif
 
 } // namespace ngn::instrumentation
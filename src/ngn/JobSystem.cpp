@@ -0,0 +1,251 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "JobSystem.hpp"
+
+#include <cassert>
+
+namespace ngn {
+
+namespace {
+
+constexpr uint32_t NoThread = std::numeric_limits<uint32_t>::max();
+
+// spins before a worker goes to sleep
+constexpr uint32_t IdleSpinCount = 256;
+
+thread_local uint32_t tThreadIndex{NoThread};
+
+} // namespace
+
+JobQueue::JobQueue() :
+    top_{},
+    bottom_{},
+    jobs_{}
+{
+}
+
+bool JobQueue::push(Job* job)
+{
+    const auto bottom = bottom_.load(std::memory_order_relaxed);
+    const auto top = top_.load(std::memory_order_acquire);
+
+    if (bottom - top >= Capacity)
+        return false;
+
+    jobs_[bottom & (Capacity - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+Job* JobQueue::pop()
+{
+    const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // empty
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    auto* job = jobs_[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+
+    if (top == bottom)
+    {
+        // last job, race against thieves
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+Job* JobQueue::steal()
+{
+    auto top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto bottom = bottom_.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+        return nullptr;
+
+    auto* job = jobs_[top & (Capacity - 1)].load(std::memory_order_relaxed);
+
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return job;
+}
+
+// *********************************************************************************************************************
+
+JobSystem::JobSystem(int32_t workerCount) :
+    queuedJobs_{},
+    sleepingWorkers_{},
+    quit_{}
+{
+    assert(tThreadIndex == NoThread && "only one job system per thread");
+
+    if (workerCount < 0)
+        workerCount = static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1U)) - 1;
+
+    const auto threadCount = static_cast<uint32_t>(workerCount) + 1;
+
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        queues_.push_back(new JobQueue{});
+        pools_.push_back(new JobPool{});
+    }
+
+    tThreadIndex = 0;
+
+    for (uint32_t i = 1; i < threadCount; i++)
+        workers_.emplace_back(&JobSystem::workerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    quit_.store(true);
+    queuedJobs_.fetch_add(1);
+    queuedJobs_.notify_all();
+
+    for (auto& worker : workers_)
+        worker.join();
+
+    for (auto* pool : pools_)
+        delete pool;
+
+    for (auto* queue : queues_)
+        delete queue;
+
+    tThreadIndex = NoThread;
+}
+
+uint32_t JobSystem::threadIndex() const
+{
+    assert(tThreadIndex != NoThread);
+    return tThreadIndex;
+}
+
+void JobSystem::submit(Job::Function function, const void* context, uint32_t begin, uint32_t end,
+                       JobCounter& counter)
+{
+    const auto index = threadIndex();
+
+    auto& pool = *pools_[index];
+    auto* job = &pool.jobs[pool.next++ % JobPool::Size];
+
+    // The job submitted Size jobs earlier still waits in a queue or was stolen but not read yet. Overwriting it would
+    // run that one twice and lose this one, so this one runs right away instead.
+    if (job->inUse.load(std::memory_order_acquire))
+    {
+        function(context, begin, end, index);
+        return;
+    }
+
+    job->function = function;
+    job->context = context;
+    job->begin = begin;
+    job->end = end;
+    job->counter = &counter;
+    job->inUse.store(true, std::memory_order_relaxed);
+
+    counter.value_.fetch_add(1, std::memory_order_relaxed);
+
+    // count the job before it can be taken by another thread
+    queuedJobs_.fetch_add(1);
+
+    if (!queues_[index]->push(job))
+    {
+        // queue is full, no reason to wait
+        queuedJobs_.fetch_sub(1);
+        execute(job, index);
+        return;
+    }
+
+    if (sleepingWorkers_.load() > 0)
+        queuedJobs_.notify_one();
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    const auto index = threadIndex();
+
+    while (!counter.done())
+    {
+        if (!executeNext(index))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::workerMain(uint32_t threadIndex)
+{
+    tThreadIndex = threadIndex;
+
+    uint32_t idleCount{};
+
+    while (!quit_.load(std::memory_order_relaxed))
+    {
+        if (executeNext(threadIndex))
+        {
+            idleCount = 0;
+            continue;
+        }
+
+        if (++idleCount < IdleSpinCount)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // the submitting thread increments queuedJobs_ before it checks for sleepers, so no wake up is lost
+        sleepingWorkers_.fetch_add(1);
+        queuedJobs_.wait(0);
+        sleepingWorkers_.fetch_sub(1);
+
+        idleCount = 0;
+    }
+}
+
+bool JobSystem::executeNext(uint32_t threadIndex)
+{
+    auto* job = queues_[threadIndex]->pop();
+
+    // steal round robin, starting at the next thread
+    const auto threadCount = static_cast<uint32_t>(queues_.size());
+    for (uint32_t i = 1; !job && i < threadCount; i++)
+        job = queues_[(threadIndex + i) % threadCount]->steal();
+
+    if (!job)
+        return false;
+
+    queuedJobs_.fetch_sub(1);
+
+    execute(job, threadIndex);
+
+    return true;
+}
+
+void JobSystem::execute(Job* job, uint32_t threadIndex)
+{
+    // copied first, so the submitting thread can reuse the slot while the job runs
+    const auto function = job->function;
+    const auto* context = job->context;
+    const auto begin = job->begin;
+    const auto end = job->end;
+    auto* counter = job->counter;
+
+    job->inUse.store(false, std::memory_order_release);
+
+    function(context, begin, end, threadIndex);
+    counter->value_.fetch_sub(1, std::memory_order_release);
+}
+
+} // namespace ngn
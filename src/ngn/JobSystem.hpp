@@ -0,0 +1,140 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Macros.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace ngn {
+
+// Counts the unfinished jobs it was passed to, JobSystem::wait() blocks until it dropped to zero.
+class JobCounter
+{
+public:
+    bool done() const { return value_.load(std::memory_order_acquire) == 0; }
+
+private:
+    std::atomic<uint32_t> value_{};
+
+    friend class JobSystem;
+};
+
+class Job
+{
+public:
+    using Function = void (*)(const void* context, uint32_t begin, uint32_t end, uint32_t threadIndex);
+
+    Function function;
+    const void* context;
+    uint32_t begin;
+    uint32_t end;
+    JobCounter* counter;
+
+    // set from submitting until a thread copied the job to execute it, the pool slot is not reused before
+    std::atomic<bool> inUse{};
+};
+
+// Fixed size Chase-Lev work stealing deque. The owning thread pushes and pops at the bottom, other threads steal
+// from the top.
+class JobQueue
+{
+public:
+    static constexpr int64_t Capacity = 1024;
+
+    JobQueue();
+
+    // returns false if the queue is full
+    bool push(Job* job);
+    Job* pop();
+    Job* steal();
+
+private:
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Job*> jobs_[Capacity];
+
+    NGN_DISABLE_COPY_MOVE(JobQueue)
+};
+
+// Runs jobs on one worker thread per core. The thread that created the job system takes part as thread 0 while it
+// waits for a counter. Jobs must only be submitted from the creating thread or from within jobs.
+class JobSystem
+{
+public:
+    // workerCount < 0 starts one worker per additional hardware thread
+    explicit JobSystem(int32_t workerCount = -1);
+    ~JobSystem();
+
+    // number of threads executing jobs, including the creating thread
+    uint32_t threadCount() const { return static_cast<uint32_t>(queues_.size()); }
+
+    // index of the calling thread, to address per thread data
+    uint32_t threadIndex() const;
+
+    void submit(Job::Function function, const void* context, uint32_t begin, uint32_t end, JobCounter& counter);
+
+    // executes pending jobs until the counter dropped to zero
+    void wait(JobCounter& counter);
+
+    // Calls function(begin, end, threadIndex) for batches of at most batchSize indices in [0, count) and waits for
+    // all of them. The batches are always the same, only their distribution to the threads varies.
+    template<typename Function>
+    void parallelFor(uint32_t count, uint32_t batchSize, const Function& function);
+
+private:
+    class JobPool
+    {
+    public:
+        static constexpr std::size_t Size = 4 * JobQueue::Capacity;
+
+        Job jobs[Size];
+        std::size_t next{};
+    };
+
+private:
+    void workerMain(uint32_t threadIndex);
+    bool executeNext(uint32_t threadIndex);
+    void execute(Job* job, uint32_t threadIndex);
+
+private:
+    std::vector<JobQueue*> queues_;
+    std::vector<JobPool*> pools_;
+    std::vector<std::thread> workers_;
+
+    std::atomic<uint32_t> queuedJobs_;
+    std::atomic<uint32_t> sleepingWorkers_;
+    std::atomic<bool> quit_;
+
+    NGN_DISABLE_COPY_MOVE(JobSystem)
+};
+
+template<typename Function>
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const Function& function)
+{
+    if (count == 0)
+        return;
+
+    auto invoke = [](const void* context, uint32_t begin, uint32_t end, uint32_t threadIndex)
+    {
+        (*static_cast<const Function*>(context))(begin, end, threadIndex);
+    };
+
+    // a single batch is not worth the round trip
+    if (count <= batchSize)
+    {
+        function(0, count, threadIndex());
+        return;
+    }
+
+    JobCounter counter;
+
+    for (uint32_t begin = 0; begin < count; begin += batchSize)
+        submit(invoke, &function, begin, std::min(begin + batchSize, count), counter);
+
+    wait(counter);
+}
+
+} // namespace ngn
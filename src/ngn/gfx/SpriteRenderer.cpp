@@ -12,9 +12,20 @@
 #include "gfx/Renderer.hpp"
 #include <entt/entt.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
 
 namespace ngn {
 
+namespace {
+
+// takes the short way around when the angle wrapped between the two updates
+float interpolateAngle(float from, float to, float alpha)
+{
+    return from + std::remainder(to - from, 2.0f * glm::pi<float>()) * alpha;
+}
+
+} // namespace
+
 SpriteRenderer::SpriteRenderer(Renderer* renderer, uint32_t batchSize) :
     renderer_{renderer},
     spritePipeline_{new SpritePipeline{renderer_}}
@@ -195,7 +206,7 @@ void SpriteRenderer::renderSprite(const SpriteVertex& vertex)
     batch.count++;
 }
 
-void SpriteRenderer::renderSpriteComponents(entt::registry* registry)
+void SpriteRenderer::renderSpriteComponents(entt::registry* registry, float alpha)
 {
     NGN_INSTRUMENT_FUNCTION();
 
@@ -208,15 +219,15 @@ void SpriteRenderer::renderSpriteComponents(entt::registry* registry)
 
         NGN_INSTRUMENT_BLOCK_BANDWIDTH_VAR(ls, "<load-sprite>", sizeof(Sprite));
 
-        auto [rot, sca] = registry->try_get<const Rotation, const Scale>(e);
+        auto [rot, sca, prev] = registry->try_get<const Rotation, const Scale, const PreviousTransform>(e);
 
         NGN_SCOPETIMER_STOP(ls)
 
         NGN_INSTRUMENT_BLOCK_BANDWIDTH_VAR(ps, "<push-sprite>", sizeof(SpriteVertex));
 
         auto& v = batch.mapped[batch.count];
-        v.position = pos.value;
-        v.rotation = rot ? rot->angle : 0.0f;
+        v.position = prev ? glm::mix(prev->position, pos.value, alpha) : pos.value;
+        v.rotation = rot ? (prev ? interpolateAngle(prev->angle, rot->angle, alpha) : rot->angle) : 0.0f;
         v.scale = spr.size * (sca ? sca->value : glm::vec2{1, 1});
         v.color = spr.color;
         v.texCoords = spr.texCoords;
@@ -31,7 +31,8 @@ public:
     void updateView(const glm::mat4& view, uint32_t frameIndex);
     void renderSprite(const SpriteVertex& vertex);
 
-    void renderSpriteComponents(entt::registry* registry);
+    // alpha interpolates the sprites with a PreviousTransform between it and their current transform
+    void renderSpriteComponents(entt::registry* registry, float alpha = 1.0f);
 
     void draw(CommandBuffer* commandBuffer);
 
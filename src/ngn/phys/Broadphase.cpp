@@ -0,0 +1,10 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "Broadphase.hpp"
+
+namespace ngn {
+
+Broadphase::~Broadphase() = default;
+
+} // namespace ngn
@@ -0,0 +1,79 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "utils/FunctionRef.hpp"
+#include <entt/fwd.hpp>
+#include <span>
+
+namespace ngn {
+
+class AABB;
+class CollisionFilter;
+class Line;
+
+enum class BroadphaseType : uint8_t
+{
+    // DynamicTree, fits any mix of body sizes
+    Tree,
+    // uniform grid of WorldConfig::gridCellSize, fits many bodies of about the cell size
+    Grid,
+};
+
+class BroadphaseStats
+{
+public:
+    uint32_t objectCount{};
+    // tree: number of nodes, grid: number of cell entries
+    uint32_t nodeCount{};
+    // tree: height, grid: most entries of one cell bucket
+    uint32_t depth{};
+    // tree: summed inner node area relative to the root, grid: mean entries of the used cell buckets
+    float cost{};
+};
+
+// Finds the dynamic bodies which might touch. Objects are stored with enlarged bounds so they only need to be updated
+// once they left them.
+class Broadphase
+{
+public:
+    using PairCallback = FunctionRef<bool(entt::entity lhs, entt::entity rhs)>;
+    using QueryCallback = FunctionRef<bool(entt::entity entity, const AABB& aabb)>;
+    using RayCastCallback = FunctionRef<float(entt::entity entity, float maxFraction)>;
+    using BoundsCallback = FunctionRef<void(const AABB& aabb, bool object)>;
+
+public:
+    virtual ~Broadphase();
+
+    virtual uint32_t addObject(const AABB& aabb, entt::entity entity, const CollisionFilter& filter) = 0;
+    // returns false if the enlarged bounds still contain the new bounds
+    virtual bool updateObject(uint32_t objectId, const AABB& aabb) = 0;
+    virtual void removeObject(uint32_t objectId) = 0;
+
+    virtual const AABB& fatAABB(uint32_t objectId) const = 0;
+    virtual entt::entity entity(uint32_t objectId) const = 0;
+
+    // Called once per update after the objects were updated. The few objects updated after it, like fast bodies stopped
+    // at their time of impact, must still be found by the following queries.
+    virtual void finishUpdate() = 0;
+
+    // Calls callback(lhs, rhs) once for every pair of overlapping objects of which at least one is in moved and whose
+    // filters collide, returning false stops the search.
+    virtual void queryPairs(std::span<const uint32_t> moved, const PairCallback& callback) = 0;
+
+    // Calls callback(entity, fatAABB) for objects overlapping aabb, returning false stops the query.
+    virtual void query(const AABB& aabb, const QueryCallback& callback) const = 0;
+
+    // Calls callback(entity, maxFraction) for objects whose bounds are crossed by the segment up to maxFraction. The
+    // callback returns the new maxFraction, 0 stops the cast. Returns the last maxFraction.
+    virtual float rayCast(const Line& segment, float maxFraction, const RayCastCallback& callback) const = 0;
+
+    // Calls callback(aabb, object) for the bounds of all objects and of the structure holding them, for debug drawing.
+    virtual void walkBounds(const BoundsCallback& callback) const = 0;
+
+    // Walks all nodes or cell buckets, meant for diagnostics and not for every update.
+    virtual BroadphaseStats stats() const = 0;
+};
+
+} // namespace ngn
@@ -4,8 +4,9 @@
 #pragma once
 
 #include "Allocators.hpp"
+#include "utils/FlatHash.hpp"
 #include <entt/fwd.hpp>
-#include <unordered_set>
+#include <vector>
 
 namespace ngn {
 
@@ -25,8 +26,45 @@ public:
     {
         return (bodyA == bodyId || bodyB == bodyId);
     }
+
+    // identifies the pair independent of the order of both bodies
+    uint64_t key() const
+    {
+        const auto a = static_cast<uint64_t>(bodyA);
+        const auto b = static_cast<uint64_t>(bodyB);
+        return a < b ? (a << 32 | b) : (b << 32 | a);
+    }
+};
+
+template<>
+struct FlatHash<CollisionPair>
+{
+    std::size_t operator()(const CollisionPair& pair) const { return pair.key(); }
 };
 
+// Category and mask bits of a body, two bodies are tested for collisions if the category of each of them is in the
+// mask of the other one.
+class CollisionFilter
+{
+public:
+    uint32_t categoryBits{1};
+    uint32_t maskBits{0xFFFFFFFF};
+
+    bool collides(const CollisionFilter& other) const
+    {
+        return (categoryBits & other.maskBits) != 0 && (other.categoryBits & maskBits) != 0;
+    }
+};
+
+// filter of a group of bodies, it collides with another one if any of the bodies might
+inline CollisionFilter combine(const CollisionFilter& one, const CollisionFilter& two)
+{
+    return {
+        .categoryBits = one.categoryBits | two.categoryBits,
+        .maskBits = one.maskBits | two.maskBits,
+    };
+}
+
 class Collision
 {
 public:
@@ -37,23 +75,20 @@ public:
     bool colliding{false};
 };
 
+class RayHit
+{
+public:
+    entt::entity entity{};
+    glm::vec2 point{};
+    // surface normal at the hit point, pointing against the cast
+    glm::vec2 normal{};
+    // position of the hit along the cast segment, 0 at its start and 1 at its end
+    float fraction{};
+};
+
 using MovedList = std::vector<uint32_t, LinearAllocator<uint32_t>>;
-using CollisionPairSet = std::unordered_set<CollisionPair, std::hash<CollisionPair>,
-                                            std::equal_to<>, LinearAllocator<CollisionPair>>;
+using IndexList = std::vector<uint32_t, LinearAllocator<uint32_t>>;
+using EntityList = std::vector<entt::entity, LinearAllocator<entt::entity>>;
 using CollisionList = std::vector<Collision, LinearAllocator<Collision>>;
 
 } // namespace ngn
-
-namespace std {
-
-template<>
-struct hash<ngn::CollisionPair>
-{
-    std::size_t operator()(const ngn::CollisionPair& cp) const
-    {
-        using std::hash;
-        return hash<entt::entity>{}(cp.bodyA) ^ hash<entt::entity>{}(cp.bodyB);
-    }
-};
-
-} // namespace
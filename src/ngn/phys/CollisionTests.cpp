@@ -5,8 +5,13 @@
 
 #include "Collision.hpp"
 #include "Shapes.hpp"
+#include "Macros.hpp"
 #include <glm/gtx/norm.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <immintrin.h>
+#include <limits>
 
 namespace ngn {
 
@@ -14,14 +19,31 @@ namespace {
 
 constexpr float LINE_WIDTH = 0.02f;
 
+// direction of the vector of length len, coincident points get a fixed one instead of NaN
+glm::vec2 normalized(const glm::vec2& vector, float len)
+{
+    return len > 0.0f ? vector / len : glm::vec2{0.0f, 1.0f};
+}
+
+float cross(const glm::vec2& lhs, const glm::vec2& rhs)
+{
+    return lhs.x * rhs.y - lhs.y * rhs.x;
+}
+
+glm::vec2 closestOnSegment(const glm::vec2& start, const glm::vec2& axis, float axisLen2, const glm::vec2& point)
+{
+    const auto t = glm::clamp(glm::dot(axis, point - start) / axisLen2, 0.0f, 1.0f);
+    return start + axis * t;
+}
+
 void testCollision(Collision& collision, const Circle& lhs, const Circle& rhs)
 {
     const auto c2c = rhs.center - lhs.center;
     const auto dist = glm::length(c2c);
     const auto diff = (lhs.radius + rhs.radius) - dist;
 
-    collision.point = lhs.center + c2c / dist * lhs.radius;
-    collision.direction = c2c / dist;
+    collision.direction = normalized(c2c, dist);
+    collision.point = lhs.center + collision.direction * lhs.radius;
     collision.penetration = diff;
     collision.colliding = diff > 0.0f;
 }
@@ -30,20 +52,15 @@ void testCollision(Collision& collision,
                    const Circle& lhs,
                    const glm::vec2& rhsStart, const glm::vec2& rhsEnd, float rhsRadius)
 {
-    const auto ab = rhsEnd - rhsStart;
-    const auto ac = lhs.center - rhsStart;
-
-    const auto t0 = glm::dot(ab, ac) / glm::length2(ab);
-    const auto t = glm::clamp(t0, 0.0f, 1.0f);
-
-    const auto closest = rhsStart + ab * t;
+    const auto axis = rhsEnd - rhsStart;
+    const auto closest = closestOnSegment(rhsStart, axis, glm::length2(axis), lhs.center);
 
     const auto l2c = closest - lhs.center;
     const auto dist = glm::length(l2c);
     const auto diff = (rhsRadius + lhs.radius) - dist;
 
-    collision.point = lhs.center + l2c / dist * lhs.radius;
-    collision.direction = l2c / dist;
+    collision.direction = normalized(l2c, dist);
+    collision.point = lhs.center + collision.direction * lhs.radius;
     collision.penetration = diff;
     collision.colliding = diff > 0.0f;
 }
@@ -52,47 +69,69 @@ void testCollision(Collision& collision,
                    const glm::vec2& lhsStart, const glm::vec2& lhsEnd, float lhsRadius,
                    const glm::vec2& rhsStart, const glm::vec2& rhsEnd, float rhsRadius)
 {
-    const auto ab = lhsEnd - lhsStart;
-    const auto ac = rhsStart- lhsStart;
-    const auto ad = rhsEnd - lhsStart;
+    const auto lhsAxis = lhsEnd - lhsStart;
+    const auto lhsAxisLen2 = glm::length2(lhsAxis);
+    const auto rhsAxis = rhsEnd - rhsStart;
+    const auto rhsAxisLen2 = glm::length2(rhsAxis);
 
-    const auto abLen2 = glm::length2(ab);
+    // twice the signed distances of the end points to the line through the other segment, times its length
+    const auto rhsStartSide = cross(lhsAxis, rhsStart - lhsStart);
+    const auto rhsEndSide = cross(lhsAxis, rhsEnd - lhsStart);
+    const auto lhsStartSide = cross(rhsAxis, lhsStart - rhsStart);
+    const auto lhsEndSide = cross(rhsAxis, lhsEnd - rhsStart);
 
-    const auto acT0 = glm::dot(ab, ac) / abLen2;
-    const auto acT = glm::clamp(acT0, 0.0f, 1.0f);
+    if (rhsStartSide * rhsEndSide < 0.0f && lhsStartSide * lhsEndSide < 0.0f)
+    {
+        // The segments cross. They are pushed apart along the normal of the segment whose line the other one reaches
+        // over the least, towards the side holding most of the other one.
+        const auto lhsAxisLen = glm::sqrt(lhsAxisLen2);
+        const auto rhsAxisLen = glm::sqrt(rhsAxisLen2);
+        const auto lhsNormal = glm::vec2{-lhsAxis.y, lhsAxis.x} / lhsAxisLen;
+        const auto rhsNormal = glm::vec2{-rhsAxis.y, rhsAxis.x} / rhsAxisLen;
+        const auto lhsDepth = glm::min(glm::abs(rhsStartSide), glm::abs(rhsEndSide)) / lhsAxisLen;
+        const auto rhsDepth = glm::min(glm::abs(lhsStartSide), glm::abs(lhsEndSide)) / rhsAxisLen;
 
-    const auto adT0 = glm::dot(ab, ad) / abLen2;
-    const auto adT = glm::clamp(adT0, 0.0f, 1.0f);
+        const auto crossing = lhsStart + lhsAxis * (lhsStartSide / (lhsStartSide - lhsEndSide));
 
-    const auto closestC = lhsStart + ab + acT;
-    const auto closestD = lhsEnd + ab + adT;
+        if (lhsDepth <= rhsDepth)
+            collision.direction = rhsStartSide + rhsEndSide < 0.0f ? -lhsNormal : lhsNormal;
+        else
+            collision.direction = lhsStartSide + lhsEndSide < 0.0f ? rhsNormal : -rhsNormal;
 
-    const auto closestC2C = rhsStart - closestC;
-    const auto closestD2D = rhsEnd - closestD;
+        collision.point = crossing + collision.direction * lhsRadius;
+        collision.penetration = lhsRadius + rhsRadius + glm::min(lhsDepth, rhsDepth);
+        collision.colliding = true;
+        return;
+    }
 
-    const auto distC2 = glm::dot(closestC, closestC);
-    const auto distD2 = glm::dot(closestD, closestD);
+    // the closest points of two segments which do not cross include an end point of one of them
 
-    if (distC2 <= distD2)
-    {
-        const auto dist = glm::sqrt(distC2);
-        const auto diff = (lhsRadius + rhsRadius) - dist;
+    auto from = closestOnSegment(lhsStart, lhsAxis, lhsAxisLen2, rhsStart);
+    auto to = rhsStart;
+    auto dist2 = glm::distance2(from, to);
 
-        collision.point = closestC + closestC2C / dist * lhsRadius;
-        collision.direction = closestC2C / dist;
-        collision.penetration = diff;
-        collision.colliding = diff > 0.0f;
-    }
-    else
+    auto closer = [&from, &to, &dist2](const glm::vec2& lhsPoint, const glm::vec2& rhsPoint)
     {
-        const auto dist = glm::sqrt(distD2);
-        const auto diff = (lhsRadius + rhsRadius) - dist;
+        const auto candidateDist2 = glm::distance2(lhsPoint, rhsPoint);
+        if (candidateDist2 < dist2)
+        {
+            from = lhsPoint;
+            to = rhsPoint;
+            dist2 = candidateDist2;
+        }
+    };
 
-        collision.point = closestD + closestD2D / dist * lhsRadius;
-        collision.direction = closestD2D / dist;
-        collision.penetration = diff;
-        collision.colliding = diff > 0.0f;
-    }
+    closer(closestOnSegment(lhsStart, lhsAxis, lhsAxisLen2, rhsEnd), rhsEnd);
+    closer(lhsStart, closestOnSegment(rhsStart, rhsAxis, rhsAxisLen2, lhsStart));
+    closer(lhsEnd, closestOnSegment(rhsStart, rhsAxis, rhsAxisLen2, lhsEnd));
+
+    const auto dist = glm::sqrt(dist2);
+    const auto diff = (lhsRadius + rhsRadius) - dist;
+
+    collision.direction = normalized(to - from, dist);
+    collision.point = from + collision.direction * lhsRadius;
+    collision.penetration = diff;
+    collision.colliding = diff > 0.0f;
 }
 
 void testCollision(Collision& collision, const Line& lhs, const Circle& rhs)
@@ -121,6 +160,690 @@ void testCollision(Collision& collision,
     testCollision(collision, lhs.start, lhs.end, lhs.radius, rhsStart, rhsEnd, rhsRadius);
 }
 
+bool testRayCast(RayHit& hit, const glm::vec2& start, const glm::vec2& delta, float maxFraction,
+                 const glm::vec2& center, float radius)
+{
+    const auto s2c = start - center;
+
+    const auto c = glm::length2(s2c) - radius * radius;
+    if (c <= 0.0f)
+    {
+        hit.point = start;
+        hit.normal = c < 0.0f ? glm::normalize(s2c) : -glm::normalize(delta);
+        hit.fraction = 0.0f;
+        return true;
+    }
+
+    // solve |start + delta * t - center| = radius for the first t
+    const auto a = glm::length2(delta);
+    const auto b = glm::dot(s2c, delta);
+    const auto discriminant = b * b - a * c;
+    if (a == 0.0f || discriminant < 0.0f)
+        return false;
+
+    const auto t = (-b - glm::sqrt(discriminant)) / a;
+    if (t < 0.0f || t > maxFraction)
+        return false;
+
+    hit.point = start + delta * t;
+    hit.normal = (hit.point - center) / radius;
+    hit.fraction = t;
+    return true;
+}
+
+bool testRayCast(RayHit& hit, const glm::vec2& start, const glm::vec2& delta, float maxFraction,
+                 const glm::vec2& capStart, const glm::vec2& capEnd, float radius)
+{
+    const auto axis = capEnd - capStart;
+    const auto axisLen2 = glm::length2(axis);
+
+    if (axisLen2 == 0.0f)
+        return testRayCast(hit, start, delta, maxFraction, capStart, radius);
+
+    // inside, distance to the axis is below the radius
+    const auto t0 = glm::clamp(glm::dot(start - capStart, axis) / axisLen2, 0.0f, 1.0f);
+    const auto s2a = start - (capStart + axis * t0);
+    if (glm::length2(s2a) <= radius * radius)
+    {
+        hit.point = start;
+        hit.normal = glm::length2(s2a) > 0.0f ? glm::normalize(s2a) : -glm::normalize(delta);
+        hit.fraction = 0.0f;
+        return true;
+    }
+
+    // from outside the first hit of the caps and both sides is where the segment enters
+
+    bool found = false;
+
+    for (const auto& center : {capStart, capEnd})
+    {
+        if (testRayCast(hit, start, delta, maxFraction, center, radius))
+        {
+            maxFraction = hit.fraction;
+            found = true;
+        }
+    }
+
+    const auto normal = glm::vec2{-axis.y, axis.x} / glm::sqrt(axisLen2);
+
+    for (const auto side : {normal, -normal})
+    {
+        const auto sideStart = capStart + side * radius;
+
+        const auto denom = delta.x * axis.y - delta.y * axis.x;
+        if (denom == 0.0f)
+            continue;
+
+        const auto s2s = sideStart - start;
+        const auto t = (s2s.x * axis.y - s2s.y * axis.x) / denom;
+        const auto u = (s2s.x * delta.y - s2s.y * delta.x) / denom;
+
+        if (t < 0.0f || t > maxFraction || u < 0.0f || u > 1.0f)
+            continue;
+
+        hit.point = start + delta * t;
+        hit.normal = side;
+        hit.fraction = t;
+        maxFraction = t;
+        found = true;
+    }
+
+    return found;
+}
+
+// Convex shapes as their core vertices grown by a radius: circles have one vertex, lines and capsules two, boxes four.
+// Boxes and polygons are tested and cast against as hulls, the other shapes keep their own tests.
+class Hull
+{
+public:
+    explicit Hull(const Shape& shape)
+    {
+        switch (shape.type)
+        {
+            using enum Shape::Type;
+
+            case Circle:
+                vertices[0] = shape.circle.center;
+                count = 1;
+                radius = shape.circle.radius;
+                break;
+
+            case Line:
+                vertices[0] = shape.line.start;
+                vertices[1] = shape.line.end;
+                count = 2;
+                radius = LINE_WIDTH;
+                break;
+
+            case Capsule:
+                vertices[0] = shape.capsule.start;
+                vertices[1] = shape.capsule.end;
+                count = 2;
+                radius = shape.capsule.radius;
+                break;
+
+            case Box:
+            {
+                const auto corners = shape.box.corners();
+                std::copy(corners.begin(), corners.end(), vertices.begin());
+                count = 4;
+                break;
+            }
+
+            case ConvexPolygon:
+                assert(shape.polygon.count >= 3 && shape.polygon.count <= vertices.size());
+                std::copy_n(shape.polygon.vertices, shape.polygon.count, vertices.begin());
+                count = shape.polygon.count;
+                break;
+
+            case Invalid:
+                break;
+        }
+    }
+
+    // a segment has a single edge, a point one of zero length
+    uint32_t edgeCount() const { return count > 2 ? count : 1; }
+    const glm::vec2& edgeStart(uint32_t edge) const { return vertices[edge]; }
+    const glm::vec2& edgeEnd(uint32_t edge) const { return vertices[edge + 1 < count ? edge + 1 : 0]; }
+
+    glm::vec2 centroid() const
+    {
+        glm::vec2 sum{};
+        for (uint32_t i = 0; i < count; i++)
+            sum += vertices[i];
+        return sum / static_cast<float>(count);
+    }
+
+    void project(const glm::vec2& axis, float& min, float& max) const
+    {
+        min = max = glm::dot(axis, vertices[0]);
+        for (uint32_t i = 1; i < count; i++)
+        {
+            const auto projection = glm::dot(axis, vertices[i]);
+            min = glm::min(min, projection);
+            max = glm::max(max, projection);
+        }
+    }
+
+    // average of the vertices furthest along axis, the middle of an edge facing it
+    glm::vec2 support(const glm::vec2& axis) const
+    {
+        float min;
+        float max;
+        project(axis, min, max);
+
+        glm::vec2 sum{};
+        float n{};
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (glm::dot(axis, vertices[i]) >= max - SupportTolerance)
+            {
+                sum += vertices[i];
+                n += 1.0f;
+            }
+        }
+        return sum / n;
+    }
+
+    std::array<glm::vec2, ConvexPolygon::MaxVertices> vertices;
+    uint32_t count{};
+    float radius{};
+
+private:
+    static constexpr float SupportTolerance = 0.01f;
+};
+
+bool isHull(const Shape& shape)
+{
+    return shape.type == Shape::Type::Box || shape.type == Shape::Type::ConvexPolygon;
+}
+
+glm::vec2 closestOnEdge(const glm::vec2& start, const glm::vec2& end, const glm::vec2& point)
+{
+    const auto axis = end - start;
+    const auto axisLen2 = glm::length2(axis);
+    return axisLen2 > 0.0f ? closestOnSegment(start, axis, axisLen2, point) : start;
+}
+
+class Separation
+{
+public:
+    // smallest overlap of the cores, along axis pointing from the first to the second hull
+    float overlap{std::numeric_limits<float>::max()};
+    glm::vec2 axis{};
+    // the axis is an edge normal of the first hull
+    bool firstReference{};
+};
+
+// Separating axis test of the cores over the edge normals of from. Returns false if one of them separates the cores.
+bool findSeparation(Separation& separation, const Hull& from, const Hull& first, const Hull& second, bool firstIsFrom)
+{
+    if (from.count < 2)
+        return true;
+
+    for (uint32_t edge = 0; edge < from.edgeCount(); edge++)
+    {
+        const auto e = from.edgeEnd(edge) - from.edgeStart(edge);
+        const auto len = glm::length(e);
+        if (len == 0.0f)
+            continue;
+
+        const auto normal = glm::vec2{-e.y, e.x} / len;
+
+        float firstMin;
+        float firstMax;
+        float secondMin;
+        float secondMax;
+        first.project(normal, firstMin, firstMax);
+        second.project(normal, secondMin, secondMax);
+
+        const auto forward = firstMax - secondMin;
+        const auto backward = secondMax - firstMin;
+        const auto overlap = glm::min(forward, backward);
+        if (overlap < 0.0f)
+            return false;
+
+        if (overlap < separation.overlap)
+        {
+            separation.overlap = overlap;
+            separation.axis = forward <= backward ? normal : -normal;
+            separation.firstReference = firstIsFrom;
+        }
+    }
+
+    return true;
+}
+
+void testCollision(Collision& collision, const Hull& lhs, const Hull& rhs)
+{
+    Separation separation;
+    const auto overlapping =
+            findSeparation(separation, lhs, lhs, rhs, true) && findSeparation(separation, rhs, lhs, rhs, false);
+
+    if (overlapping)
+    {
+        // The cores overlap, they are pushed apart along the axis of least overlap. The contact is the deepest point of
+        // the hull not owning the axis, moved onto the surface of lhs like the other tests do.
+        const auto& axis = separation.axis;
+
+        collision.direction = axis;
+        collision.penetration = separation.overlap + lhs.radius + rhs.radius;
+        collision.point = separation.firstReference ?
+                rhs.support(-axis) - axis * rhs.radius + axis * collision.penetration :
+                lhs.support(axis) + axis * lhs.radius;
+        collision.colliding = true;
+        return;
+    }
+
+    // the closest points of two separate convex hulls include a vertex of one of them
+
+    auto from = lhs.vertices[0];
+    auto to = rhs.vertices[0];
+    auto dist2 = std::numeric_limits<float>::max();
+
+    auto closer = [&from, &to, &dist2](const glm::vec2& lhsPoint, const glm::vec2& rhsPoint)
+    {
+        const auto candidateDist2 = glm::distance2(lhsPoint, rhsPoint);
+        if (candidateDist2 < dist2)
+        {
+            from = lhsPoint;
+            to = rhsPoint;
+            dist2 = candidateDist2;
+        }
+    };
+
+    for (uint32_t edge = 0; edge < rhs.edgeCount(); edge++)
+    {
+        for (uint32_t i = 0; i < lhs.count; i++)
+            closer(lhs.vertices[i], closestOnEdge(rhs.edgeStart(edge), rhs.edgeEnd(edge), lhs.vertices[i]));
+    }
+
+    for (uint32_t edge = 0; edge < lhs.edgeCount(); edge++)
+    {
+        for (uint32_t i = 0; i < rhs.count; i++)
+            closer(closestOnEdge(lhs.edgeStart(edge), lhs.edgeEnd(edge), rhs.vertices[i]), rhs.vertices[i]);
+    }
+
+    const auto dist = glm::sqrt(dist2);
+    const auto diff = (lhs.radius + rhs.radius) - dist;
+
+    collision.direction = normalized(to - from, dist);
+    collision.point = from + collision.direction * lhs.radius;
+    collision.penetration = diff;
+    collision.colliding = diff > 0.0f;
+}
+
+// hulls with at least three vertices, the ones of boxes and polygons grown by the radius of a cast circle
+bool testRayCast(RayHit& hit, const glm::vec2& start, const glm::vec2& delta, float maxFraction, const Hull& hull)
+{
+    assert(hull.count >= 3);
+
+    const auto centroid = hull.centroid();
+
+    auto outwardNormal = [&hull, &centroid](uint32_t edge)
+    {
+        const auto e = hull.edgeEnd(edge) - hull.edgeStart(edge);
+        const auto normal = glm::normalize(glm::vec2{-e.y, e.x});
+        return glm::dot(normal, hull.edgeStart(edge) - centroid) < 0.0f ? -normal : normal;
+    };
+
+    bool inside = true;
+    for (uint32_t edge = 0; edge < hull.edgeCount() && inside; edge++)
+        inside = glm::dot(outwardNormal(edge), start - hull.edgeStart(edge)) <= 0.0f;
+
+    if (inside)
+    {
+        hit.point = start;
+        hit.normal = -glm::normalize(delta);
+        hit.fraction = 0.0f;
+        return true;
+    }
+
+    // a grown hull is the core and the capsules around its edges, which are hit before the core
+    if (hull.radius > 0.0f)
+    {
+        bool found = false;
+
+        for (uint32_t edge = 0; edge < hull.edgeCount(); edge++)
+        {
+            if (testRayCast(hit, start, delta, maxFraction, hull.edgeStart(edge), hull.edgeEnd(edge), hull.radius))
+            {
+                maxFraction = hit.fraction;
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+    // clip the segment against the sides, it enters on the last side it crosses inwards
+
+    float enter = 0.0f;
+    float exit = maxFraction;
+    glm::vec2 enterNormal{};
+
+    for (uint32_t edge = 0; edge < hull.edgeCount(); edge++)
+    {
+        const auto normal = outwardNormal(edge);
+        const auto distance = glm::dot(normal, hull.edgeStart(edge) - start);
+        const auto speed = glm::dot(normal, delta);
+
+        if (speed == 0.0f)
+        {
+            if (distance < 0.0f)
+                return false;
+            continue;
+        }
+
+        const auto t = distance / speed;
+        if (speed < 0.0f && t > enter)
+        {
+            enter = t;
+            enterNormal = normal;
+        }
+        else if (speed > 0.0f && t < exit)
+        {
+            exit = t;
+        }
+
+        if (enter > exit)
+            return false;
+    }
+
+    if (enterNormal == glm::vec2{})
+        return false;
+
+    hit.point = start + delta * enter;
+    hit.normal = enterNormal;
+    hit.fraction = enter;
+    return true;
+}
+
+#if defined(__AVX2__)
+
+// Eight 2D vectors, the lanes of the batched tests. The functions follow the scalar tests operation by operation, only
+// the square roots are replaced by the approximate reciprocal square root refined by one Newton-Raphson step.
+
+class Vec2x8
+{
+public:
+    __m256 x;
+    __m256 y;
+};
+
+Vec2x8 operator+(const Vec2x8& lhs, const Vec2x8& rhs)
+{
+    return {_mm256_add_ps(lhs.x, rhs.x), _mm256_add_ps(lhs.y, rhs.y)};
+}
+
+Vec2x8 operator-(const Vec2x8& lhs, const Vec2x8& rhs)
+{
+    return {_mm256_sub_ps(lhs.x, rhs.x), _mm256_sub_ps(lhs.y, rhs.y)};
+}
+
+Vec2x8 operator*(const Vec2x8& lhs, __m256 rhs)
+{
+    return {_mm256_mul_ps(lhs.x, rhs), _mm256_mul_ps(lhs.y, rhs)};
+}
+
+__m256 dot(const Vec2x8& lhs, const Vec2x8& rhs)
+{
+    return _mm256_add_ps(_mm256_mul_ps(lhs.x, rhs.x), _mm256_mul_ps(lhs.y, rhs.y));
+}
+
+__m256 cross(const Vec2x8& lhs, const Vec2x8& rhs)
+{
+    return _mm256_sub_ps(_mm256_mul_ps(lhs.x, rhs.y), _mm256_mul_ps(lhs.y, rhs.x));
+}
+
+__m256 abs(__m256 value)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value);
+}
+
+Vec2x8 select(__m256 mask, const Vec2x8& ifFalse, const Vec2x8& ifTrue)
+{
+    return {_mm256_blendv_ps(ifFalse.x, ifTrue.x, mask), _mm256_blendv_ps(ifFalse.y, ifTrue.y, mask)};
+}
+
+// 1 / sqrt(value), 0 for 0 so that coincident points keep a finite direction
+__m256 invSqrt(__m256 value)
+{
+    const auto estimate = _mm256_rsqrt_ps(value);
+    const auto halfValue = _mm256_mul_ps(_mm256_set1_ps(0.5f), value);
+    const auto refined = _mm256_mul_ps(estimate, _mm256_sub_ps(_mm256_set1_ps(1.5f),
+            _mm256_mul_ps(halfValue, _mm256_mul_ps(estimate, estimate))));
+    return _mm256_and_ps(refined, _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GT_OQ));
+}
+
+Vec2x8 closestOnSegment(const Vec2x8& start, const Vec2x8& axis, __m256 axisLen2, const Vec2x8& point)
+{
+    const auto t0 = _mm256_div_ps(dot(axis, point - start), axisLen2);
+    const auto t = _mm256_min_ps(_mm256_max_ps(t0, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    return start + axis * t;
+}
+
+// Transposes the four floats of eight rows, passed as rows 0 to 3 in the lower and rows 4 to 7 in the upper halves, into
+// four columns of eight values. Applied to four columns it gives back the rows in the same layout.
+void transpose(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+{
+    const auto t0 = _mm256_unpacklo_ps(r0, r1);
+    const auto t1 = _mm256_unpacklo_ps(r2, r3);
+    const auto t2 = _mm256_unpackhi_ps(r0, r1);
+    const auto t3 = _mm256_unpackhi_ps(r2, r3);
+    r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+__m256 loadRows(const float* lower, const float* upper)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lower)), _mm_loadu_ps(upper), 1);
+}
+
+// Circles are loaded as center and radius, lines and capsules as start and end, four floats each. Reading four floats
+// from a circle stays within the union.
+static_assert(sizeof(Capsule) >= 4 * sizeof(float));
+
+const float* shapeData(const Shape& shape)
+{
+    switch (shape.type)
+    {
+        using enum Shape::Type;
+
+        case Circle:
+            return &shape.circle.center.x;
+
+        case Line:
+            return &shape.line.start.x;
+
+        case Capsule:
+        case Box:
+        case ConvexPolygon:
+        case Invalid:
+            break;
+    }
+
+    return &shape.capsule.start.x;
+}
+
+// the shapes of one side of eight pairs, transposed into lanes
+class ShapeLanes
+{
+public:
+    void loadCircles(std::span<const Shape* const> shapes)
+    {
+        __m256 unused;
+        load(shapes, start.x, start.y, radius, unused);
+    }
+
+    void loadSegments(std::span<const Shape* const> shapes)
+    {
+        load(shapes, start.x, start.y, end.x, end.y);
+
+        alignas(32) float radii[8];
+        for (std::size_t lane = 0; lane < 8; lane++)
+            radii[lane] = shapes[lane]->type == Shape::Type::Line ? LINE_WIDTH : shapes[lane]->capsule.radius;
+        radius = _mm256_load_ps(radii);
+    }
+
+    // center of circles
+    Vec2x8 start;
+    Vec2x8 end;
+    __m256 radius;
+
+private:
+    static void load(std::span<const Shape* const> shapes, __m256& c0, __m256& c1, __m256& c2, __m256& c3)
+    {
+        c0 = loadRows(shapeData(*shapes[0]), shapeData(*shapes[4]));
+        c1 = loadRows(shapeData(*shapes[1]), shapeData(*shapes[5]));
+        c2 = loadRows(shapeData(*shapes[2]), shapeData(*shapes[6]));
+        c3 = loadRows(shapeData(*shapes[3]), shapeData(*shapes[7]));
+        transpose(c0, c1, c2, c3);
+    }
+};
+
+// point and direction are written together, four floats per collision
+static_assert(offsetof(Collision, direction) == offsetof(Collision, point) + sizeof(glm::vec2));
+
+class CollisionLanes
+{
+public:
+    void set(const Vec2x8& fromPoint, const Vec2x8& vector, __m256 dist2, __m256 radiusSum, __m256 fromRadius)
+    {
+        const auto invDist = invSqrt(dist2);
+        const auto dist = _mm256_mul_ps(dist2, invDist);
+        const auto zero = _mm256_cmp_ps(dist2, _mm256_setzero_ps(), _CMP_EQ_OQ);
+
+        direction = select(zero, vector * invDist, Vec2x8{_mm256_setzero_ps(), _mm256_set1_ps(1.0f)});
+        point = fromPoint + direction * fromRadius;
+        penetration = _mm256_sub_ps(radiusSum, dist);
+    }
+
+    void store(std::span<Collision> collisions, bool flip) const
+    {
+        const auto sign = _mm256_set1_ps(flip ? -1.0f : 1.0f);
+
+        auto r0 = point.x;
+        auto r1 = point.y;
+        auto r2 = _mm256_mul_ps(direction.x, sign);
+        auto r3 = _mm256_mul_ps(direction.y, sign);
+        transpose(r0, r1, r2, r3);
+
+        const __m256 rows[4] = {r0, r1, r2, r3};
+        for (std::size_t row = 0; row < 4; row++)
+        {
+            _mm_storeu_ps(&collisions[row].point.x, _mm256_castps256_ps128(rows[row]));
+            _mm_storeu_ps(&collisions[row + 4].point.x, _mm256_extractf128_ps(rows[row], 1));
+        }
+
+        alignas(32) float penetrations[8];
+        _mm256_store_ps(penetrations, penetration);
+
+        for (std::size_t lane = 0; lane < 8; lane++)
+        {
+            collisions[lane].penetration = penetrations[lane];
+            collisions[lane].colliding = penetrations[lane] > 0.0f;
+        }
+    }
+
+    Vec2x8 point;
+    Vec2x8 direction;
+    __m256 penetration;
+};
+
+CollisionLanes testCircleCircle(const ShapeLanes& lhs, const ShapeLanes& rhs)
+{
+    const auto c2c = rhs.start - lhs.start;
+
+    CollisionLanes result;
+    result.set(lhs.start, c2c, dot(c2c, c2c), _mm256_add_ps(lhs.radius, rhs.radius), lhs.radius);
+    return result;
+}
+
+CollisionLanes testCircleSegment(const ShapeLanes& circle, const ShapeLanes& segment)
+{
+    const auto axis = segment.end - segment.start;
+    const auto closest = closestOnSegment(segment.start, axis, dot(axis, axis), circle.start);
+
+    const auto l2c = closest - circle.start;
+
+    CollisionLanes result;
+    result.set(circle.start, l2c, dot(l2c, l2c), _mm256_add_ps(segment.radius, circle.radius), circle.radius);
+    return result;
+}
+
+CollisionLanes testSegmentSegment(const ShapeLanes& lhs, const ShapeLanes& rhs)
+{
+    const auto lhsAxis = lhs.end - lhs.start;
+    const auto lhsAxisLen2 = dot(lhsAxis, lhsAxis);
+    const auto rhsAxis = rhs.end - rhs.start;
+    const auto rhsAxisLen2 = dot(rhsAxis, rhsAxis);
+
+    auto from = closestOnSegment(lhs.start, lhsAxis, lhsAxisLen2, rhs.start);
+    auto to = rhs.start;
+    auto dist2 = dot(to - from, to - from);
+
+    auto closer = [&from, &to, &dist2](const Vec2x8& lhsPoint, const Vec2x8& rhsPoint)
+    {
+        const auto candidateDist2 = dot(rhsPoint - lhsPoint, rhsPoint - lhsPoint);
+        const auto mask = _mm256_cmp_ps(candidateDist2, dist2, _CMP_LT_OQ);
+        from = select(mask, from, lhsPoint);
+        to = select(mask, to, rhsPoint);
+        dist2 = _mm256_blendv_ps(dist2, candidateDist2, mask);
+    };
+
+    closer(closestOnSegment(lhs.start, lhsAxis, lhsAxisLen2, rhs.end), rhs.end);
+    closer(lhs.start, closestOnSegment(rhs.start, rhsAxis, rhsAxisLen2, lhs.start));
+    closer(lhs.end, closestOnSegment(rhs.start, rhsAxis, rhsAxisLen2, lhs.end));
+
+    const auto radiusSum = _mm256_add_ps(lhs.radius, rhs.radius);
+
+    CollisionLanes result;
+    result.set(from, to - from, dist2, radiusSum, lhs.radius);
+
+    const auto zero = _mm256_setzero_ps();
+    const auto rhsStartSide = cross(lhsAxis, rhs.start - lhs.start);
+    const auto rhsEndSide = cross(lhsAxis, rhs.end - lhs.start);
+    const auto lhsStartSide = cross(rhsAxis, lhs.start - rhs.start);
+    const auto lhsEndSide = cross(rhsAxis, lhs.end - rhs.start);
+
+    const auto crossing = _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_mul_ps(rhsStartSide, rhsEndSide), zero, _CMP_LT_OQ),
+            _mm256_cmp_ps(_mm256_mul_ps(lhsStartSide, lhsEndSide), zero, _CMP_LT_OQ));
+    if (_mm256_testz_ps(crossing, crossing))
+        return result;
+
+    const auto lhsInvLen = invSqrt(lhsAxisLen2);
+    const auto rhsInvLen = invSqrt(rhsAxisLen2);
+    const auto lhsDepth = _mm256_mul_ps(_mm256_min_ps(abs(rhsStartSide), abs(rhsEndSide)), lhsInvLen);
+    const auto rhsDepth = _mm256_mul_ps(_mm256_min_ps(abs(lhsStartSide), abs(lhsEndSide)), rhsInvLen);
+
+    // the sign of the side holding most of the other segment, flipped for the normal of rhs, see the scalar test
+    const auto signBit = _mm256_set1_ps(-0.0f);
+    const auto lhsSign = _mm256_and_ps(_mm256_add_ps(rhsStartSide, rhsEndSide), signBit);
+    const auto rhsSign = _mm256_andnot_ps(_mm256_add_ps(lhsStartSide, lhsEndSide), signBit);
+    const auto lhsNormal = Vec2x8{_mm256_xor_ps(_mm256_sub_ps(zero, lhsAxis.y), lhsSign),
+                                  _mm256_xor_ps(lhsAxis.x, lhsSign)} * lhsInvLen;
+    const auto rhsNormal = Vec2x8{_mm256_xor_ps(_mm256_sub_ps(zero, rhsAxis.y), rhsSign),
+                                  _mm256_xor_ps(rhsAxis.x, rhsSign)} * rhsInvLen;
+
+    const auto useLhs = _mm256_cmp_ps(lhsDepth, rhsDepth, _CMP_LE_OQ);
+    const auto direction = select(useLhs, rhsNormal, lhsNormal);
+    const auto depth = _mm256_min_ps(lhsDepth, rhsDepth);
+
+    const auto t = _mm256_div_ps(lhsStartSide, _mm256_sub_ps(lhsStartSide, lhsEndSide));
+    const auto point = lhs.start + lhsAxis * t + direction * lhs.radius;
+
+    result.direction = select(crossing, result.direction, direction);
+    result.point = select(crossing, result.point, point);
+    result.penetration = _mm256_blendv_ps(result.penetration, _mm256_add_ps(radiusSum, depth), crossing);
+    return result;
+}
+
+#endif
+
 } // namespace
 
 // *********************************************************************************************************************
@@ -163,6 +886,12 @@ bool intersects(const Line& lhs, const AABB& rhs)
 
 void testCollision(Collision& collision, const Shape& lhs, const Shape& rhs)
 {
+    if (isHull(lhs) || isHull(rhs))
+    {
+        testCollision(collision, Hull{lhs}, Hull{rhs});
+        return;
+    }
+
     auto test = [&collision, &rhs]<typename T>(const T& lhsT)
     {
         switch (rhs.type)
@@ -181,6 +910,8 @@ void testCollision(Collision& collision, const Shape& lhs, const Shape& rhs)
                 testCollision(collision, lhsT, rhs.capsule.start, rhs.capsule.end, rhs.capsule.radius);
                 break;
 
+            case Box:
+            case ConvexPolygon:
             case Invalid:
                 break;
         }
@@ -202,9 +933,161 @@ void testCollision(Collision& collision, const Shape& lhs, const Shape& rhs)
             test(lhs.capsule);
             break;
 
+        case Box:
+        case ConvexPolygon:
         case Invalid:
             break;
     }
 }
 
+CollisionKernel collisionKernel(const Shape& lhs, const Shape& rhs)
+{
+    if (lhs.type == Shape::Type::Invalid || rhs.type == Shape::Type::Invalid)
+        return CollisionKernel::None;
+
+    if (isHull(lhs) || isHull(rhs))
+        return CollisionKernel::Polygon;
+
+    const auto lhsCircle = lhs.type == Shape::Type::Circle;
+    const auto rhsCircle = rhs.type == Shape::Type::Circle;
+
+    if (lhsCircle)
+        return rhsCircle ? CollisionKernel::CircleCircle : CollisionKernel::CircleCapsule;
+    return rhsCircle ? CollisionKernel::CapsuleCircle : CollisionKernel::CapsuleCapsule;
+}
+
+void testCollisions(CollisionKernel kernel, std::span<const Shape* const> lhs, std::span<const Shape* const> rhs,
+                    std::span<Collision> collisions)
+{
+    assert(lhs.size() == collisions.size() && rhs.size() == collisions.size());
+
+    std::size_t index{};
+
+#if defined(__AVX2__)
+    ShapeLanes lhsLanes;
+    ShapeLanes rhsLanes;
+
+    const auto batched = kernel != CollisionKernel::Polygon && kernel != CollisionKernel::None;
+
+    for (; batched && index + 8 <= collisions.size(); index += 8)
+    {
+        const auto lhsShapes = lhs.subspan(index, 8);
+        const auto rhsShapes = rhs.subspan(index, 8);
+        const auto results = collisions.subspan(index, 8);
+
+        switch (kernel)
+        {
+            using enum CollisionKernel;
+
+            case CircleCircle:
+                lhsLanes.loadCircles(lhsShapes);
+                rhsLanes.loadCircles(rhsShapes);
+                testCircleCircle(lhsLanes, rhsLanes).store(results, false);
+                break;
+
+            case CircleCapsule:
+                lhsLanes.loadCircles(lhsShapes);
+                rhsLanes.loadSegments(rhsShapes);
+                testCircleSegment(lhsLanes, rhsLanes).store(results, false);
+                break;
+
+            case CapsuleCircle:
+                // tested from the circle like the scalar test, only the direction is turned around
+                lhsLanes.loadSegments(lhsShapes);
+                rhsLanes.loadCircles(rhsShapes);
+                testCircleSegment(rhsLanes, lhsLanes).store(results, true);
+                break;
+
+            case CapsuleCapsule:
+                lhsLanes.loadSegments(lhsShapes);
+                rhsLanes.loadSegments(rhsShapes);
+                testSegmentSegment(lhsLanes, rhsLanes).store(results, false);
+                break;
+
+            case Polygon:
+            case None:
+                break;
+        }
+    }
+#else
+    NGN_UNUSED(kernel);
+#endif
+
+    for (; index < collisions.size(); index++)
+        testCollision(collisions[index], *lhs[index], *rhs[index]);
+}
+
+bool testRayCast(RayHit& hit, const Line& segment, float maxFraction, const Shape& shape)
+{
+    const auto delta = segment.end - segment.start;
+
+    switch (shape.type)
+    {
+        using enum Shape::Type;
+
+        case Circle:
+            return testRayCast(hit, segment.start, delta, maxFraction, shape.circle.center, shape.circle.radius);
+
+        case Line:
+            return testRayCast(hit, segment.start, delta, maxFraction, shape.line.start, shape.line.end, LINE_WIDTH);
+
+        case Capsule:
+            return testRayCast(hit, segment.start, delta, maxFraction,
+                               shape.capsule.start, shape.capsule.end, shape.capsule.radius);
+
+        case Box:
+        case ConvexPolygon:
+            return testRayCast(hit, segment.start, delta, maxFraction, Hull{shape});
+
+        case Invalid:
+            break;
+    }
+
+    return false;
+}
+
+bool testCircleCast(RayHit& hit, float radius, const Line& path, float maxFraction, const Shape& shape)
+{
+    const auto delta = path.end - path.start;
+
+    // the center of the circle is cast against the shape grown by the radius
+    bool found = false;
+
+    switch (shape.type)
+    {
+        using enum Shape::Type;
+
+        case Circle:
+            found = testRayCast(hit, path.start, delta, maxFraction, shape.circle.center, shape.circle.radius + radius);
+            break;
+
+        case Line:
+            found = testRayCast(hit, path.start, delta, maxFraction,
+                                shape.line.start, shape.line.end, LINE_WIDTH + radius);
+            break;
+
+        case Capsule:
+            found = testRayCast(hit, path.start, delta, maxFraction,
+                                shape.capsule.start, shape.capsule.end, shape.capsule.radius + radius);
+            break;
+
+        case Box:
+        case ConvexPolygon:
+        {
+            Hull hull{shape};
+            hull.radius += radius;
+            found = testRayCast(hit, path.start, delta, maxFraction, hull);
+            break;
+        }
+
+        case Invalid:
+            break;
+    }
+
+    if (found)
+        hit.point -= hit.normal * radius;
+
+    return found;
+}
+
 } // namespace ngn
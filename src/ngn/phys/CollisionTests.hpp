@@ -3,11 +3,15 @@
 
 #pragma once
 
+#include <cstdint>
+#include <span>
+
 namespace ngn {
 
 class AABB;
 class Collision;
 class Line;
+class RayHit;
 class Shape;
 
 bool intersects(const AABB& lhs, const AABB& rhs);
@@ -15,6 +19,33 @@ bool intersects(const Line& lhs, const AABB& rhs);
 
 void testCollision(Collision& collision, const Shape& lhs, const Shape& rhs);
 
+// Shape type pairs the batched tests are sorted into, lines are tested as thin capsules. Pairs with a box or polygon
+// are sorted together but tested with the scalar test only.
+enum class CollisionKernel : uint8_t
+{
+    CircleCircle,
+    CircleCapsule,
+    CapsuleCircle,
+    CapsuleCapsule,
+    Polygon,
+    None,
+};
+
+CollisionKernel collisionKernel(const Shape& lhs, const Shape& rhs);
+
+// Same as testCollision() for every pair, all of which must have the given kernel. Eight pairs at a time are tested
+// with AVX2, the remaining ones with the scalar test, which stays the reference of the batched one.
+void testCollisions(CollisionKernel kernel, std::span<const Shape* const> lhs, std::span<const Shape* const> rhs,
+                    std::span<Collision> collisions);
+
+// Fills point, normal and fraction of the hit if the segment hits the shape before maxFraction. A segment starting
+// inside the shape hits it at fraction 0.
+bool testRayCast(RayHit& hit, const Line& segment, float maxFraction, const Shape& shape);
+
+// Sweeps a circle of radius along path and fills the hit of its first contact with the shape before maxFraction. The
+// point is on the surface of the shape, the normal points towards the circle. An overlapping circle hits at 0.
+bool testCircleCast(RayHit& hit, float radius, const Line& path, float maxFraction, const Shape& shape);
+
 // minDistance(const Shape& lhs, const Shape& rhs);
 
 } // namespace ngn
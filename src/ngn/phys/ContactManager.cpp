@@ -0,0 +1,41 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "ContactManager.hpp"
+
+namespace ngn {
+
+ContactManager::ContactManager()
+{
+}
+
+bool ContactManager::addContact(const CollisionPair& pair, bool sensor)
+{
+    const auto [it, inserted] = indices_.try_emplace(pair.key(), size());
+    if (!inserted)
+        return false;
+
+    contacts_.push_back(Contact{
+        .collision = Collision{.pair = pair},
+        .sensor = sensor,
+    });
+
+    return true;
+}
+
+void ContactManager::removeContact(uint32_t index)
+{
+    assert(index < contacts_.size());
+
+    indices_.erase(contacts_[index].collision.pair.key());
+
+    if (index != contacts_.size() - 1)
+    {
+        contacts_[index] = std::move(contacts_.back());
+        indices_[contacts_[index].collision.pair.key()] = index;
+    }
+
+    contacts_.pop_back();
+}
+
+} // namespace ngn
@@ -0,0 +1,60 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Collision.hpp"
+#include "Macros.hpp"
+#include "utils/FlatHash.hpp"
+#include <vector>
+
+namespace ngn {
+
+enum class ContactEvent : uint8_t
+{
+    Begin,
+    Persist,
+    End,
+};
+
+class Contact
+{
+public:
+    // result of the last narrow phase test, colliding tells whether the bodies are touching
+    Collision collision;
+    // accumulated by the solver while the bodies are touching, the next update starts from it
+    float normalImpulse{};
+    bool sensor{};
+};
+
+// Keeps the pairs found by the broad phase over frames, until their fat AABBs stop overlapping or one of the
+// bodies leaves the world.
+class ContactManager
+{
+public:
+    ContactManager();
+
+    // returns false if a contact for the pair already exists
+    bool addContact(const CollisionPair& pair, bool sensor);
+
+    // moves the last contact to index
+    void removeContact(uint32_t index);
+
+    uint32_t size() const { return static_cast<uint32_t>(contacts_.size()); }
+
+    Contact& contact(uint32_t index)
+    {
+        assert(index < contacts_.size());
+        return contacts_[index];
+    }
+
+    const std::vector<Contact>& contacts() const { return contacts_; }
+
+private:
+    std::vector<Contact> contacts_;
+    FlatHashMap<uint64_t, uint32_t> indices_;
+
+    NGN_DISABLE_COPY_MOVE(ContactManager)
+};
+
+} // namespace ngn
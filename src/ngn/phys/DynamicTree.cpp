@@ -4,15 +4,43 @@
 
 #include "DynamicTree.hpp"
 
+#include "JobSystem.hpp"
+#include <array>
 #include <entt/entt.hpp>
 
 namespace ngn {
 
+namespace {
+
+constexpr uint32_t SahBinCount = 16;
+
+// sub trees with less leaves are not worth a job
+constexpr std::size_t ParallelBuildLeafCount = 1024;
+
+
+class SahBin
+{
+public:
+    AABB aabb;
+    uint32_t count;
+};
+
+
+glm::vec2 centerOf(const AABB& aabb)
+{
+    return (aabb.topLeft + aabb.bottomRight) * 0.5f;
+}
+
+} // namespace
+
 DynamicTree::DynamicTree(entt::registry* registry) :
     registry_{registry},
+    optimizeIndex_(0),
     rootIndex_(TreeNode::NullNode),
     firstFreeIndex_(TreeNode::NullNode),
-    firstLeafIndex_(TreeNode::NullNode)
+    firstLeafIndex_(TreeNode::NullNode),
+    wideRootIndex_(TreeNode::NullNode),
+    wideNodesValid_(false)
 {
     checkCapacity();
 }
@@ -22,48 +50,540 @@ bool DynamicTree::initialize()
     return true;
 }
 
-uint32_t DynamicTree::addObject(const AABB& aabb, entt::entity entity)
+uint32_t DynamicTree::addObject(const AABB& aabb, entt::entity entity, const CollisionFilter& filter)
 {
     const auto index = allocateNode();
-    TreeNode& node = nodes_[index];
 
-    node.aabb = enlargeAABB(aabb);
-    node.entity = entity;
+    nodes_[index].aabb = enlargeAABB(aabb);
+    nodes_[index].filter = filter;
+    nodeInfos_[index].entity = entity;
+
+    uint32_t objectId{};
+    if (!freeObjects_.empty())
+    {
+        objectId = freeObjects_.back();
+        freeObjects_.pop_back();
+        objects_[objectId] = index;
+    }
+    else
+    {
+        objectId = static_cast<uint32_t>(objects_.size());
+        objects_.push_back(index);
+    }
+    nodeInfos_[index].object = objectId;
 
     insertLeaf(index);
 
-    return index;
+    return objectId;
 }
 
-bool DynamicTree::updateObject(uint32_t treeNode, const AABB& aabb)
+bool DynamicTree::updateObject(uint32_t objectId, const AABB& aabb)
 {
-    assert(treeNode < nodes_.size());
+    assert(objectId < objects_.size());
 
-    TreeNode& node = nodes_[treeNode];
+    const auto index = objects_[objectId];
+    TreeNode& node = nodes_[index];
 
     if (contains(node.aabb, aabb))
         return false;
 
     node.aabb = enlargeAABB(aabb);
 
-    updateLeaf(treeNode);
+    updateLeaf(index);
 
     return true;
 }
 
-void DynamicTree::removeObject(uint32_t treeNode)
+void DynamicTree::removeObject(uint32_t objectId)
+{
+    assert(objectId < objects_.size());
+
+    const auto index = objects_[objectId];
+
+    removeLeaf(index);
+    deallocateNode(index);
+
+    objects_[objectId] = TreeNode::NullNode;
+    freeObjects_.push_back(objectId);
+}
+
+void DynamicTree::clear()
+{
+    const auto lastIndex = capacity() - 1;
+    for (uint32_t i = 0; i < lastIndex; ++i)
+    {
+        nodeInfos_[i].nextFree = i + 1;
+        nodeInfos_[i].height = TreeNodeInfo::FreeHeight;
+    }
+    nodeInfos_[lastIndex].nextFree = TreeNode::NullNode;
+    nodeInfos_[lastIndex].height = TreeNodeInfo::FreeHeight;
+
+    rootIndex_ = TreeNode::NullNode;
+    firstFreeIndex_ = 0;
+
+    objects_.clear();
+    freeObjects_.clear();
+
+    wideNodes_.clear();
+    wideRootIndex_ = TreeNode::NullNode;
+    wideNodesValid_ = false;
+}
+
+void DynamicTree::build(std::span<const TreeBuildItem> items, std::span<uint32_t> objectIds, JobSystem* jobSystem)
+{
+    assert(items.size() == objectIds.size());
+
+    clear();
+
+    std::vector<uint32_t> leaves(items.size());
+    objects_.resize(items.size());
+
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+        const auto index = allocateNode();
+        const auto objectId = static_cast<uint32_t>(i);
+
+        nodes_[index].aabb = enlargeAABB(items[i].aabb);
+        nodes_[index].filter = items[i].filter;
+        nodeInfos_[index].entity = items[i].entity;
+        nodeInfos_[index].object = objectId;
+
+        objects_[objectId] = index;
+        leaves[i] = index;
+        objectIds[i] = objectId;
+    }
+
+    buildHierarchy(leaves, jobSystem);
+}
+
+void DynamicTree::rebuild(JobSystem* jobSystem)
+{
+    if (rootIndex_ == TreeNode::NullNode)
+        return;
+
+    // keep the leaves and release all inner nodes
+
+    std::vector<uint32_t> leaves;
+    std::vector<uint32_t> stack;
+
+    stack.push_back(rootIndex_);
+
+    while (!stack.empty())
+    {
+        const auto index = stack.back();
+        stack.pop_back();
+
+        const TreeNode& node = nodes_[index];
+
+        if (node.isLeaf())
+        {
+            leaves.push_back(index);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+
+        deallocateNode(index);
+    }
+
+    buildHierarchy(leaves, jobSystem);
+}
+
+void DynamicTree::optimize(uint32_t budget)
+{
+    if (rootIndex_ == TreeNode::NullNode)
+        return;
+
+    uint32_t visited{};
+
+    for (uint32_t i = 0; i < capacity() && visited < budget; ++i)
+    {
+        const auto index = optimizeIndex_;
+        optimizeIndex_ = (optimizeIndex_ + 1) % capacity();
+
+        if (nodeInfos_[index].isFree() || nodes_[index].isLeaf())
+            continue;
+
+        rotateNode(index);
+        visited++;
+    }
+}
+
+void DynamicTree::relayout()
+{
+    if (rootIndex_ == TreeNode::NullNode)
+        return;
+
+    // new index of each node in depth first order, NullNode for free nodes
+
+    std::vector<uint32_t> newIndices(capacity(), TreeNode::NullNode);
+    uint32_t count{};
+
+    StaticVector<uint32_t, TreeQueryStackSize> stack;
+
+    stack.emplace_back(rootIndex_);
+
+    while (!stack.empty())
+    {
+        const auto index = stack.back();
+        stack.pop_back();
+
+        newIndices[index] = count++;
+
+        const TreeNode& node = nodes_[index];
+        if (!node.isLeaf())
+        {
+            stack.emplace_back(node.right);
+            stack.emplace_back(node.left);
+        }
+    }
+
+    auto newIndexOf = [&newIndices](uint32_t index)
+    {
+        return index == TreeNode::NullNode ? TreeNode::NullNode : newIndices[index];
+    };
+
+    std::vector<TreeNode> nodes(capacity());
+    std::vector<TreeNodeInfo> nodeInfos(capacity());
+
+    for (uint32_t index = 0; index < capacity(); ++index)
+    {
+        const auto newIndex = newIndices[index];
+        if (newIndex == TreeNode::NullNode)
+            continue;
+
+        TreeNode& node = nodes[newIndex];
+        node = nodes_[index];
+        node.left = newIndexOf(node.left);
+        node.right = newIndexOf(node.right);
+
+        TreeNodeInfo& info = nodeInfos[newIndex];
+        info = nodeInfos_[index];
+        info.parent = newIndexOf(info.parent);
+
+        if (node.isLeaf())
+            objects_[info.object] = newIndex;
+    }
+
+    // the free nodes follow the used ones
+
+    for (auto index = count; index < capacity(); ++index)
+    {
+        nodeInfos[index].nextFree = index + 1 < capacity() ? index + 1 : TreeNode::NullNode;
+        nodeInfos[index].height = TreeNodeInfo::FreeHeight;
+    }
+
+    nodes_ = std::move(nodes);
+    nodeInfos_ = std::move(nodeInfos);
+
+    rootIndex_ = 0;
+    firstFreeIndex_ = count < capacity() ? count : TreeNode::NullNode;
+
+    wideNodesValid_ = false;
+}
+
+TreeStats DynamicTree::stats() const
+{
+    TreeStats stats;
+
+    if (rootIndex_ == TreeNode::NullNode)
+        return stats;
+
+    float innerArea{};
+
+    for (uint32_t index = 0; index < capacity(); ++index)
+    {
+        if (nodeInfos_[index].isFree())
+            continue;
+
+        const TreeNode& node = nodes_[index];
+
+        stats.nodeCount++;
+
+        if (node.isLeaf())
+            stats.leafCount++;
+        else
+            innerArea += area(node.aabb);
+    }
+
+    const TreeNode& root = nodes_[rootIndex_];
+
+    stats.height = nodeInfos_[rootIndex_].height;
+
+    const auto rootArea = area(root.aabb);
+    if (rootArea > 0.0f)
+        stats.sahCost = innerArea / rootArea;
+
+    return stats;
+}
+
+void DynamicTree::rebuildWideNodes()
+{
+    if (wideNodesValid_)
+        return;
+
+    wideNodes_.clear();
+    wideRootIndex_ = TreeNode::NullNode;
+
+    if (rootIndex_ != TreeNode::NullNode)
+        wideRootIndex_ = buildWideNode(rootIndex_);
+
+    wideNodesValid_ = true;
+}
+
+uint32_t DynamicTree::buildWideNode(uint32_t index)
+{
+    // collapse the binary sub tree into up to four children by repeatedly opening the largest inner node
+
+    StaticVector<uint32_t, WideTreeNode::Width> children;
+    children.emplace_back(index);
+
+    while (children.size() < WideTreeNode::Width)
+    {
+        auto largest = TreeNode::NullNode;
+        float largestArea = -1.0f;
+
+        for (uint32_t i = 0; i < children.size(); i++)
+        {
+            const TreeNode& child = nodes_[children[i]];
+            if (!child.isLeaf() && area(child.aabb) > largestArea)
+            {
+                largest = i;
+                largestArea = area(child.aabb);
+            }
+        }
+
+        if (largest == TreeNode::NullNode)
+            break;
+
+        const TreeNode& opened = nodes_[children[largest]];
+        children[largest] = opened.left;
+        children.emplace_back(opened.right);
+    }
+
+    const auto wideIndex = static_cast<uint32_t>(wideNodes_.size());
+    wideNodes_.emplace_back();
+
+    for (uint32_t i = 0; i < WideTreeNode::Width; i++)
+    {
+        auto child = TreeNode::NullNode;
+        AABB aabb{
+            .topLeft = glm::vec2{std::numeric_limits<float>::max()},
+            .bottomRight = glm::vec2{std::numeric_limits<float>::lowest()},
+        };
+        CollisionFilter filter{.categoryBits = 0, .maskBits = 0};
+        entt::entity entity = entt::null;
+
+        if (i < children.size())
+        {
+            const TreeNode& childNode = nodes_[children[i]];
+            aabb = childNode.aabb;
+            filter = childNode.filter;
+            entity = nodeInfos_[children[i]].entity;
+            // build the sub trees depth first, so siblings end up close to each other in memory
+            child = childNode.isLeaf() ? (WideTreeNode::LeafFlag | children[i]) : buildWideNode(children[i]);
+        }
+
+        // wideNodes_ may have been reallocated by the recursion
+        WideTreeNode& wideNode = wideNodes_[wideIndex];
+        wideNode.min[i] = aabb.topLeft.x;
+        wideNode.min[i + WideTreeNode::Width] = aabb.topLeft.y;
+        wideNode.max[i] = aabb.bottomRight.x;
+        wideNode.max[i + WideTreeNode::Width] = aabb.bottomRight.y;
+        wideNode.children[i] = child;
+        wideNode.categoryBits[i] = filter.categoryBits;
+        wideNode.maskBits[i] = filter.maskBits;
+        wideNode.entities[i] = entity;
+    }
+
+    return wideIndex;
+}
+
+void DynamicTree::buildHierarchy(std::span<uint32_t> leaves, JobSystem* jobSystem)
 {
-    assert(treeNode < nodes_.size());
+    wideNodesValid_ = false;
+    rootIndex_ = TreeNode::NullNode;
+
+    if (leaves.empty())
+        return;
+
+    // A sub tree of n leaves needs exactly n - 1 inner nodes. Allocating all of them up front and handing each sub tree
+    // its own range lets sub trees be built concurrently without touching the free list.
+    std::vector<uint32_t> innerNodes(leaves.size() - 1);
+    for (auto& index : innerNodes)
+        index = allocateNode();
+
+    rootIndex_ = buildSubtree(leaves, innerNodes, jobSystem);
+    nodeInfos_[rootIndex_].parent = TreeNode::NullNode;
+
+    // the leaves were allocated before the inner nodes
+    relayout();
+}
+
+uint32_t DynamicTree::buildSubtree(std::span<uint32_t> leaves, std::span<const uint32_t> innerNodes,
+                                   JobSystem* jobSystem)
+{
+    assert(innerNodes.size() + 1 == leaves.size());
+
+    if (leaves.size() == 1)
+        return leaves[0];
+
+    const auto split = partitionLeaves(leaves);
+    assert(split > 0 && split < leaves.size());
+
+    const auto index = innerNodes[0];
+    const auto leftLeaves = leaves.first(split);
+    const auto rightLeaves = leaves.subspan(split);
+    const auto leftInnerNodes = innerNodes.subspan(1, split - 1);
+    const auto rightInnerNodes = innerNodes.subspan(split);
+
+    uint32_t children[2];
+
+    if (jobSystem && leaves.size() >= ParallelBuildLeafCount)
+    {
+        jobSystem->parallelFor(2, 1, [&](uint32_t begin, uint32_t, uint32_t)
+        {
+            if (begin == 0)
+                children[0] = buildSubtree(leftLeaves, leftInnerNodes, jobSystem);
+            else
+                children[1] = buildSubtree(rightLeaves, rightInnerNodes, jobSystem);
+        });
+    }
+    else
+    {
+        children[0] = buildSubtree(leftLeaves, leftInnerNodes, nullptr);
+        children[1] = buildSubtree(rightLeaves, rightInnerNodes, nullptr);
+    }
+
+    TreeNode& node = nodes_[index];
+    const TreeNode& leftNode = nodes_[children[0]];
+    const TreeNode& rightNode = nodes_[children[1]];
+
+    node.left = children[0];
+    node.right = children[1];
+    node.aabb = combine(leftNode.aabb, rightNode.aabb);
+    node.filter = combine(leftNode.filter, rightNode.filter);
 
-    removeLeaf(treeNode);
-    deallocateNode(treeNode);
+    TreeNodeInfo& info = nodeInfos_[index];
+    info.height = static_cast<uint16_t>(
+            1 + glm::max(nodeInfos_[children[0]].height, nodeInfos_[children[1]].height));
+    info.moved = false;
+
+    nodeInfos_[children[0]].parent = index;
+    nodeInfos_[children[1]].parent = index;
+
+    return index;
+}
+
+std::size_t DynamicTree::partitionLeaves(std::span<uint32_t> leaves) const
+{
+    // split along the axis with the largest extent of the leaf centers
+
+    glm::vec2 centerMin{std::numeric_limits<float>::max()};
+    glm::vec2 centerMax{std::numeric_limits<float>::lowest()};
+
+    for (const auto index : leaves)
+    {
+        const auto center = centerOf(nodes_[index].aabb);
+        centerMin = glm::min(centerMin, center);
+        centerMax = glm::max(centerMax, center);
+    }
+
+    const auto extent = centerMax - centerMin;
+    const auto axis = extent.x >= extent.y ? 0 : 1;
+
+    // all centers at the same spot, any split is as good as another
+    if (extent[axis] <= 0.0f)
+        return leaves.size() / 2;
+
+    const auto scale = static_cast<float>(SahBinCount) / extent[axis];
+    auto binOf = [this, axis, scale, &centerMin](uint32_t index)
+    {
+        const auto center = centerOf(nodes_[index].aabb);
+        const auto bin = static_cast<uint32_t>((center[axis] - centerMin[axis]) * scale);
+        return glm::min(bin, SahBinCount - 1);
+    };
+
+    std::array<SahBin, SahBinCount> bins{};
+
+    for (const auto index : leaves)
+    {
+        auto& bin = bins[binOf(index)];
+        bin.aabb = bin.count ? combine(bin.aabb, nodes_[index].aabb) : nodes_[index].aabb;
+        bin.count++;
+    }
+
+    // cost of the right side of a split behind each bin
+
+    std::array<float, SahBinCount> rightCosts{};
+    {
+        AABB aabb{};
+        uint32_t count{};
+        for (auto i = SahBinCount - 1; i > 0; --i)
+        {
+            if (bins[i].count)
+            {
+                aabb = count ? combine(aabb, bins[i].aabb) : bins[i].aabb;
+                count += bins[i].count;
+            }
+            rightCosts[i - 1] = area(aabb) * static_cast<float>(count);
+        }
+    }
+
+    // the first and the last bin are never empty, so every split leaves leaves on both sides
+
+    uint32_t bestSplit{};
+    float bestCost{std::numeric_limits<float>::max()};
+    {
+        AABB aabb{};
+        uint32_t count{};
+        for (uint32_t i = 0; i < SahBinCount - 1; ++i)
+        {
+            if (bins[i].count)
+            {
+                aabb = count ? combine(aabb, bins[i].aabb) : bins[i].aabb;
+                count += bins[i].count;
+            }
+
+            const auto cost = area(aabb) * static_cast<float>(count) + rightCosts[i];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = i;
+            }
+        }
+    }
+
+    const auto middle = std::partition(leaves.begin(), leaves.end(), [&binOf, bestSplit](uint32_t index)
+    {
+        return binOf(index) <= bestSplit;
+    });
+
+    return static_cast<std::size_t>(middle - leaves.begin());
+}
+
+void DynamicTree::setMoved(std::span<const uint32_t> objectIds, bool moved)
+{
+    // ancestors of an already changed node are changed too, so the walk up can stop there
+    for (const auto objectId : objectIds)
+    {
+        auto index = objects_[objectId];
+        while (index != TreeNode::NullNode && nodeInfos_[index].moved != moved)
+        {
+            nodeInfos_[index].moved = moved;
+            index = nodeInfos_[index].parent;
+        }
+    }
 }
 
 void DynamicTree::insertLeaf(uint32_t index)
 {
+    wideNodesValid_ = false;
+
     auto* newNode = &nodes_[index];
 
-    assert(newNode->parent == TreeNode::NullNode);
+    assert(nodeInfos_[index].parent == TreeNode::NullNode);
     assert(newNode->left == TreeNode::NullNode);
     assert(newNode->right == TreeNode::NullNode);
 
@@ -129,13 +649,14 @@ void DynamicTree::insertLeaf(uint32_t index)
     auto* newParent = &nodes_[newParentIndex];
     newNode = &nodes_[index];
 
-    uint32_t oldParentIndex = leafSibling->parent;
-    newParent->parent = oldParentIndex;
+    uint32_t oldParentIndex = nodeInfos_[leafSiblingIndex].parent;
+    nodeInfos_[newParentIndex].parent = oldParentIndex;
     newParent->aabb = combine(newNode->aabb, leafSibling->aabb);
+    newParent->filter = combine(newNode->filter, leafSibling->filter);
     newParent->left = leafSiblingIndex;
     newParent->right = index;
-    newNode->parent = newParentIndex;
-    leafSibling->parent = newParentIndex;
+    nodeInfos_[index].parent = newParentIndex;
+    nodeInfos_[leafSiblingIndex].parent = newParentIndex;
 
     if (oldParentIndex == TreeNode::NullNode)
     {
@@ -150,11 +671,13 @@ void DynamicTree::insertLeaf(uint32_t index)
             oldParent.right = newParentIndex;
     }
 
-    syncHierarchy(newNode->parent);
+    syncHierarchy(newParentIndex);
 }
 
 void DynamicTree::removeLeaf(uint32_t index)
 {
+    wideNodesValid_ = false;
+
     // if the leaf is the root then we can just clear the root pointer and return
     if (index == rootIndex_)
     {
@@ -162,13 +685,11 @@ void DynamicTree::removeLeaf(uint32_t index)
         return;
     }
 
-    TreeNode& leafNode = nodes_[index];
-    uint32_t parentNodeIndex = leafNode.parent;
+    uint32_t parentNodeIndex = nodeInfos_[index].parent;
     const TreeNode& parentNode = nodes_[parentNodeIndex];
-    uint32_t grandParentNodeIndex = parentNode.parent;
+    uint32_t grandParentNodeIndex = nodeInfos_[parentNodeIndex].parent;
     uint32_t siblingNodeIndex = parentNode.left == index ? parentNode.right : parentNode.left;
     assert(siblingNodeIndex != TreeNode::NullNode); // we must have a sibling
-    TreeNode& siblingNode = nodes_[siblingNodeIndex];
 
     if (grandParentNodeIndex != TreeNode::NullNode)
     {
@@ -181,7 +702,7 @@ void DynamicTree::removeLeaf(uint32_t index)
         {
             grandParentNode.right = siblingNodeIndex;
         }
-        siblingNode.parent = grandParentNodeIndex;
+        nodeInfos_[siblingNodeIndex].parent = grandParentNodeIndex;
         deallocateNode(parentNodeIndex);
 
         syncHierarchy(grandParentNodeIndex);
@@ -190,11 +711,11 @@ void DynamicTree::removeLeaf(uint32_t index)
     {
         // if we have no grandparent then the parent is the root and so our sibling becomes the root and has it's parent removed
         rootIndex_ = siblingNodeIndex;
-        siblingNode.parent = TreeNode::NullNode;
+        nodeInfos_[siblingNodeIndex].parent = TreeNode::NullNode;
         deallocateNode(parentNodeIndex);
     }
 
-    leafNode.parent = TreeNode::NullNode;
+    nodeInfos_[index].parent = TreeNode::NullNode;
 }
 
 void DynamicTree::updateLeaf(uint32_t index)
@@ -207,159 +728,91 @@ void DynamicTree::syncHierarchy(uint32_t index)
 {
     while (index != TreeNode::NullNode)
     {
-        index = balance(index);
+        rotateNode(index);
 
         uint32_t left = nodes_[index].left;
         uint32_t right = nodes_[index].right;
 
-        nodes_[index].height = 1 + glm::max(nodes_[left].height, nodes_[right].height);
+        nodeInfos_[index].height = 1 + glm::max(nodeInfos_[left].height, nodeInfos_[right].height);
         nodes_[index].aabb = combine(nodes_[left].aabb, nodes_[right].aabb);
+        nodes_[index].filter = combine(nodes_[left].filter, nodes_[right].filter);
 
-        index = nodes_[index].parent;
+        index = nodeInfos_[index].parent;
     }
 }
 
-uint32_t DynamicTree::balance(uint32_t index)
+void DynamicTree::rotateNode(uint32_t index)
 {
-    assert(index != TreeNode::NullNode);
+    // Swapping a child with a grand child on the other side keeps the bounds of the node itself, only the bounds of
+    // the other child change. Take the swap which shrinks them the most.
 
-    TreeNode& A = nodes_[index];
-    if (A.isLeaf() || A.height < 2)
-    {
-        return index;
-    }
+    uint32_t bestChild = TreeNode::NullNode;
+    uint32_t bestGrandChild = TreeNode::NullNode;
+    float bestDelta{};
 
-    uint32_t iB = A.left;
-    uint32_t iC = A.right;
-    assert(iB < capacity());
-    assert(iC < capacity());
+    const TreeNode& node = nodes_[index];
+    assert(!node.isLeaf());
 
-    TreeNode& B = nodes_[iB];
-    TreeNode& C = nodes_[iC];
-
-    int16_t balance = static_cast<int16_t>(C.height - B.height);
-
-    // Rotate C up
-    if (balance > 1)
+    for (const auto child : {node.left, node.right})
     {
-        uint32_t iF = C.left;
-        uint32_t iG = C.right;
-        assert(iF < capacity());
-        assert(iG < capacity());
-        TreeNode& F = nodes_[iF];
-        TreeNode& G = nodes_[iG];
+        const auto other = child == node.left ? node.right : node.left;
+        const TreeNode& otherNode = nodes_[other];
+        if (otherNode.isLeaf())
+            continue;
 
-        // Swap A and C
-        C.left = index;
-        C.parent = A.parent;
-        A.parent = iC;
+        const auto otherArea = area(otherNode.aabb);
 
-        // A's old parent should point to C
-        if (C.parent != TreeNode::NullNode)
+        for (const auto grandChild : {otherNode.left, otherNode.right})
         {
-            if (nodes_[C.parent].left == index)
-            {
-                nodes_[C.parent].left = iC;
-            }
-            else
+            const auto remaining = grandChild == otherNode.left ? otherNode.right : otherNode.left;
+            const auto delta = area(combine(nodes_[child].aabb, nodes_[remaining].aabb)) - otherArea;
+            if (delta < bestDelta)
             {
-                assert(nodes_[C.parent].right == index);
-                nodes_[C.parent].right = iC;
+                bestDelta = delta;
+                bestChild = child;
+                bestGrandChild = grandChild;
             }
         }
-        else
-        {
-            rootIndex_ = iC;
-        }
+    }
 
-        // Rotate
-        if (F.height > G.height)
-        {
-            C.right = iF;
-            A.right = iG;
-            G.parent = index;
-            A.aabb = combine(B.aabb, G.aabb);
-            C.aabb = combine(A.aabb, F.aabb);
-
-            A.height = 1 + glm::max(B.height, G.height);
-            C.height = 1 + glm::max(A.height, F.height);
-        }
-        else
-        {
-            C.right = iG;
-            A.right = iF;
-            F.parent = index;
-            A.aabb = combine(B.aabb, F.aabb);
-            C.aabb = combine(A.aabb, G.aabb);
-
-            A.height = 1 + glm::max(B.height, F.height);
-            C.height = 1 + glm::max(A.height, G.height);
-        }
+    if (bestChild == TreeNode::NullNode)
+        return;
 
-        return iC;
-    }
+    wideNodesValid_ = false;
 
-    // Rotate B up
-    if (balance < -1)
-    {
-        uint32_t iD = B.left;
-        uint32_t iE = B.right;
-        assert(iD < capacity());
-        assert(iE < capacity());
-        TreeNode& D = nodes_[iD];
-        TreeNode& E = nodes_[iE];
+    const auto other = nodeInfos_[bestGrandChild].parent;
 
-        // Swap A and B
-        B.left = index;
-        B.parent = A.parent;
-        A.parent = iB;
+    TreeNode& parentNode = nodes_[index];
+    TreeNode& otherNode = nodes_[other];
 
-        // A's old parent should point to B
-        if (B.parent != TreeNode::NullNode)
-        {
-            if (nodes_[B.parent].left == index)
-            {
-                nodes_[B.parent].left = iB;
-            }
-            else
-            {
-                assert(nodes_[B.parent].right == index);
-                nodes_[B.parent].right = iB;
-            }
-        }
-        else
-        {
-            rootIndex_ = iB;
-        }
+    if (parentNode.left == bestChild)
+        parentNode.left = bestGrandChild;
+    else
+        parentNode.right = bestGrandChild;
 
-        // Rotate
-        if (D.height > E.height)
-        {
-            B.right = iD;
-            A.left = iE;
-            E.parent = index;
-            A.aabb = combine(C.aabb, E.aabb);
-            B.aabb = combine(A.aabb, D.aabb);
-
-            A.height = 1 + glm::max(C.height, E.height);
-            B.height = 1 + glm::max(A.height, D.height);
-        }
-        else
-        {
-            B.right = iE;
-            A.left = iD;
-            D.parent = index;
-            A.aabb = combine(C.aabb, D.aabb);
-            B.aabb = combine(A.aabb, E.aabb);
-
-            A.height = 1 + glm::max(C.height, D.height);
-            B.height = 1 + glm::max(A.height, E.height);
-        }
+    if (otherNode.left == bestGrandChild)
+        otherNode.left = bestChild;
+    else
+        otherNode.right = bestChild;
 
-        return iB;
-    }
+    nodeInfos_[bestGrandChild].parent = index;
+    nodeInfos_[bestChild].parent = other;
 
-    return index;
+    otherNode.aabb = combine(nodes_[otherNode.left].aabb, nodes_[otherNode.right].aabb);
+    otherNode.filter = combine(nodes_[otherNode.left].filter, nodes_[otherNode.right].filter);
+    nodeInfos_[other].height = static_cast<uint16_t>(
+            1 + glm::max(nodeInfos_[otherNode.left].height, nodeInfos_[otherNode.right].height));
+
+    // the bounds above stay the same, but the heights might change
+    for (auto ancestor = index; ancestor != TreeNode::NullNode; ancestor = nodeInfos_[ancestor].parent)
+    {
+        const TreeNode& ancestorNode = nodes_[ancestor];
+        const auto height = static_cast<uint16_t>(
+                1 + glm::max(nodeInfos_[ancestorNode.left].height, nodeInfos_[ancestorNode.right].height));
+        if (height == nodeInfos_[ancestor].height)
+            break;
+        nodeInfos_[ancestor].height = height;
+    }
 }
 
 AABB DynamicTree::enlargeAABB(AABB aabb) const
@@ -376,13 +829,14 @@ void DynamicTree::checkCapacity()
         size_t oldSize = nodes_.size();
 
         nodes_.resize(glm::max(1UL, oldSize * 2));
+        nodeInfos_.resize(nodes_.size());
 
         size_t li = nodes_.size() - 1;
         for (size_t i = oldSize; i < li; ++i)
         {
-            nodes_[i].nextFree = static_cast<uint32_t>(i) + 1;
+            nodeInfos_[i].nextFree = static_cast<uint32_t>(i) + 1;
         }
-        nodes_[li].nextFree = TreeNode::NullNode;
+        nodeInfos_[li].nextFree = TreeNode::NullNode;
 
         firstFreeIndex_ = static_cast<uint32_t>(oldSize);
     }
@@ -395,22 +849,26 @@ uint32_t DynamicTree::allocateNode()
     uint32_t newIdx = firstFreeIndex_;
 
     TreeNode& node = nodes_[newIdx];
+    TreeNodeInfo& info = nodeInfos_[newIdx];
 
-    firstFreeIndex_ = node.nextFree;
+    firstFreeIndex_ = info.nextFree;
 
-    node.parent = TreeNode::NullNode;
     node.left = TreeNode::NullNode;
     node.right = TreeNode::NullNode;
-    node.height = 0;
+    info.parent = TreeNode::NullNode;
+    info.entity = entt::null;
+    info.object = TreeNode::NullNode;
+    info.height = 0;
 
     return newIdx;
 }
 
 void DynamicTree::deallocateNode(uint32_t index)
 {
-    TreeNode& node = nodes_[index];
+    TreeNodeInfo& info = nodeInfos_[index];
 
-    node.nextFree = firstFreeIndex_;
+    info.nextFree = firstFreeIndex_;
+    info.height = TreeNodeInfo::FreeHeight;
     firstFreeIndex_ = index;
 }
 
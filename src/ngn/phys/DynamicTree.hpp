@@ -5,10 +5,14 @@
 #pragma once
 
 #include "Shapes.hpp"
+#include "phys/Collision.hpp"
 #include "phys/CollisionTests.hpp"
 #include "phys/Functions.hpp"
 #include "utils/StaticVector.hpp"
+#include <bit>
 #include <entt/fwd.hpp>
+#include <immintrin.h>
+#include <span>
 
 namespace ngn {
 
@@ -18,29 +22,90 @@ constexpr std::size_t TreeQueryStackSize = 1024;
 
 } // namespace
 
+class JobSystem;
 class WorldObject;
 
-class TreeNode
+// The part of a node read while the tree is traversed, two of them share a cache line.
+class alignas(32) TreeNode
 {
 public:
     static constexpr uint32_t NullNode = std::numeric_limits<uint32_t>::max();
 
     bool isLeaf() const { return right == NullNode; }
 
+    AABB aabb{};
+
+    uint32_t left{NullNode};
+    uint32_t right{NullNode};
+
+    // of the body for leaves, combined from the children for inner nodes
+    CollisionFilter filter{};
+};
+
+// The part of a node only needed to modify the tree or to report a leaf, stored in a separate array at the same index.
+class TreeNodeInfo
+{
+public:
+    static constexpr uint16_t FreeHeight = std::numeric_limits<uint16_t>::max();
+
+    bool isFree() const { return height == FreeHeight; }
+
     union
     {
         uint32_t parent;
-        uint32_t nextFree{NullNode};
+        uint32_t nextFree{TreeNode::NullNode};
     };
 
-    uint32_t left{NullNode};
-    uint32_t right{NullNode};
-
-    AABB aabb{};
     entt::entity entity{};
+    // id of the object stored in a leaf, see DynamicTree::addObject()
+    uint32_t object{TreeNode::NullNode};
+
+    // FreeHeight while the node is in the free list
+    uint16_t height{FreeHeight};
+
+    // set on moved leaves and their ancestors while pairs are queried
+    bool moved{};
+};
+
+// Collapsed 4-wide version of the binary tree, used for queries. The bounds of all children are stored as
+// structure of arrays (x0..x3, y0..y3), so one node can be tested against a query box with a single AVX2 compare.
+class WideTreeNode
+{
+public:
+    static constexpr uint32_t Width = 4;
+    static constexpr uint32_t LeafFlag = 0x80000000;
+
+    alignas(32) float min[Width * 2];
+    alignas(32) float max[Width * 2];
+
+    // index of a wide node or LeafFlag | index of the leaf in the binary tree
+    uint32_t children[Width];
+
+    // filters of the children, 0 for unused slots
+    uint32_t categoryBits[Width];
+    uint32_t maskBits[Width];
 
-    uint16_t height{0};
-    bool updated{};
+    // entities of leaf children, so queries do not need to load the leaves
+    entt::entity entities[Width];
+};
+
+class TreeStats
+{
+public:
+    uint32_t height{};
+    uint32_t nodeCount{};
+    uint32_t leafCount{};
+    // summed area of all inner nodes relative to the area of the root, the lower the cheaper queries are
+    float sahCost{};
+};
+
+// input of DynamicTree::build()
+class TreeBuildItem
+{
+public:
+    AABB aabb;
+    entt::entity entity;
+    CollisionFilter filter{};
 };
 
 class DynamicTree
@@ -50,9 +115,31 @@ public:
 
     bool initialize();
 
-    uint32_t addObject(const AABB& aabb, entt::entity entity);
-    bool updateObject(uint32_t ndoeId, const AABB& aabb);
-    void removeObject(uint32_t nodeId);
+    // Returns the id of the new object. Unlike the index of its leaf it stays the same when the nodes are moved.
+    uint32_t addObject(const AABB& aabb, entt::entity entity, const CollisionFilter& filter = {});
+    bool updateObject(uint32_t objectId, const AABB& aabb);
+    void removeObject(uint32_t objectId);
+
+    // removes all objects but keeps the allocated nodes
+    void clear();
+
+    // Replaces the content of the tree by the given objects, the object id of items[i] is written to objectIds[i].
+    // The hierarchy is built top down by binned SAH splits, sub trees are built in parallel if a job system is given.
+    void build(std::span<const TreeBuildItem> items, std::span<uint32_t> objectIds, JobSystem* jobSystem = nullptr);
+
+    // Builds the hierarchy of the current objects from scratch like build(), the object ids stay valid.
+    void rebuild(JobSystem* jobSystem = nullptr);
+
+    // Undoes the degradation of incremental updates by rotating up to budget inner nodes where this lowers the summed
+    // node area. Each call continues with the nodes following the ones of the last call.
+    void optimize(uint32_t budget);
+
+    // Incremental updates scatter the nodes over the array. This moves them into depth first order with the left child
+    // following its parent, so walking down the tree reads consecutive memory. The object ids stay valid.
+    void relayout();
+
+    // walks all nodes, meant for diagnostics
+    TreeStats stats() const;
 
     template<typename Callback>
     void walkTree(const Callback& callback) const;
@@ -60,18 +147,55 @@ public:
     template<typename Callback>
     void query(const AABB& aabb, const Callback& callback) const;
 
-    const TreeNode& node(uint32_t index) const
+    // Same as query() for leaves whose filter collides with the given one, sub trees without any are skipped.
+    template<typename Callback>
+    void query(const AABB& aabb, const CollisionFilter& filter, const Callback& callback) const;
+
+    // Calls callback(lhsEntity, rhsEntity) once for every pair of overlapping objects of which at least one is in moved
+    // and whose filters collide. Pairs are found by descending two sub trees at once, so a pair of two moved leaves is
+    // reported only once. Pairs of sub trees whose combined filters do not collide are skipped as a whole.
+    template<typename Callback>
+    void queryPairs(std::span<const uint32_t> moved, const Callback& callback);
+
+    // Walks the leaves whose box is crossed by the segment up to maxFraction, nearer boxes first. The callback is
+    // called as callback(entity, maxFraction) and returns the new maxFraction, 0 stops the cast. Returns the last
+    // maxFraction.
+    template<typename Callback>
+    float rayCast(const Line& segment, float maxFraction, const Callback& callback) const;
+
+    // Must be called after the tree was modified to let query() use the wide node layout again.
+    // Until then queries fall back to walking the binary tree. Only pays off for trees that are queried far more often
+    // than they are modified, like the static tree.
+    void rebuildWideNodes();
+
+    const AABB& fatAABB(uint32_t objectId) const
+    {
+        assert(objectId < objects_.size());
+        return nodes_[objects_[objectId]].aabb;
+    }
+
+    entt::entity entity(uint32_t objectId) const
     {
-        assert(index < nodes_.size());
-        return nodes_[index];
+        assert(objectId < objects_.size());
+        return nodeInfos_[objects_[objectId]].entity;
     }
 
 private:
+    template<typename Callback>
+    void queryBinary(const AABB& aabb, const CollisionFilter* filter, const Callback& callback) const;
+    template<typename Callback>
+    void queryWide(const AABB& aabb, const CollisionFilter* filter, const Callback& callback) const;
+    uint32_t buildWideNode(uint32_t index);
+    void buildHierarchy(std::span<uint32_t> leaves, JobSystem* jobSystem);
+    uint32_t buildSubtree(std::span<uint32_t> leaves, std::span<const uint32_t> innerNodes, JobSystem* jobSystem);
+    std::size_t partitionLeaves(std::span<uint32_t> leaves) const;
+    void setMoved(std::span<const uint32_t> objectIds, bool moved);
+
     void insertLeaf(uint32_t index);
     void removeLeaf(uint32_t index);
     void updateLeaf(uint32_t index);
     void syncHierarchy(uint32_t index);
-    uint32_t balance(uint32_t index);
+    void rotateNode(uint32_t index);
 
     AABB enlargeAABB(AABB aabb) const;
 
@@ -84,17 +208,151 @@ private:
     entt::registry* registry_;
 
     std::vector<TreeNode> nodes_;
+    std::vector<TreeNodeInfo> nodeInfos_;
+    uint32_t optimizeIndex_;
+
+    // index of the leaf of each object, NullNode for unused ids
+    std::vector<uint32_t> objects_;
+    std::vector<uint32_t> freeObjects_;
 
     uint32_t rootIndex_;
     uint32_t firstFreeIndex_;
     uint32_t firstLeafIndex_;
+
+    std::vector<WideTreeNode> wideNodes_;
+    uint32_t wideRootIndex_;
+    bool wideNodesValid_;
+};
+
+// ********************************************************
+
+namespace detail {
+
+class WideQueryBox
+{
+public:
+    explicit WideQueryBox(const AABB& aabb)
+    {
+#if defined(__AVX2__)
+        min_ = _mm256_setr_ps(
+                    aabb.topLeft.x, aabb.topLeft.x, aabb.topLeft.x, aabb.topLeft.x,
+                    aabb.topLeft.y, aabb.topLeft.y, aabb.topLeft.y, aabb.topLeft.y);
+        max_ = _mm256_setr_ps(
+                    aabb.bottomRight.x, aabb.bottomRight.x, aabb.bottomRight.x, aabb.bottomRight.x,
+                    aabb.bottomRight.y, aabb.bottomRight.y, aabb.bottomRight.y, aabb.bottomRight.y);
+#else
+        aabb_ = aabb;
+#endif
+    }
+
+    // returns a bit mask of the children intersecting the query box
+    uint32_t intersects(const WideTreeNode& node) const
+    {
+#if defined(__AVX2__)
+        const auto nodeMin = _mm256_load_ps(node.min);
+        const auto nodeMax = _mm256_load_ps(node.max);
+        const auto hit = _mm256_and_ps(
+                    _mm256_cmp_ps(nodeMin, max_, _CMP_LE_OQ),
+                    _mm256_cmp_ps(min_, nodeMax, _CMP_LE_OQ));
+        const auto mask = static_cast<uint32_t>(_mm256_movemask_ps(hit));
+        return mask & (mask >> WideTreeNode::Width) & 0xF;
+#else
+        uint32_t mask{};
+        for (uint32_t i = 0; i < WideTreeNode::Width; i++)
+        {
+            const auto hit =
+                    (node.min[i] <= aabb_.bottomRight.x) &
+                    (node.min[i + WideTreeNode::Width] <= aabb_.bottomRight.y) &
+                    (aabb_.topLeft.x <= node.max[i]) &
+                    (aabb_.topLeft.y <= node.max[i + WideTreeNode::Width]);
+            mask |= static_cast<uint32_t>(hit) << i;
+        }
+        return mask;
+#endif
+    }
+
+private:
+#if defined(__AVX2__)
+    __m256 min_;
+    __m256 max_;
+#else
+    AABB aabb_;
+#endif
 };
 
+class RaySlab
+{
+public:
+    explicit RaySlab(const Line& segment) :
+        start_{segment.start},
+        delta_{segment.end - segment.start},
+        invDelta_{1.0f / delta_}
+    {
+    }
+
+    // Fraction of the segment where it enters the box, if it does so before maxFraction. A segment starting inside
+    // enters at 0.
+    bool enters(const AABB& aabb, float maxFraction, float& fraction) const
+    {
+        float tMin = 0.0f;
+        float tMax = maxFraction;
+
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (delta_[axis] == 0.0f)
+            {
+                // parallel to the slab, infinite inverse would give nan for a start on the boundary
+                if (start_[axis] < aabb.topLeft[axis] || start_[axis] > aabb.bottomRight[axis])
+                    return false;
+                continue;
+            }
+
+            auto t1 = (aabb.topLeft[axis] - start_[axis]) * invDelta_[axis];
+            auto t2 = (aabb.bottomRight[axis] - start_[axis]) * invDelta_[axis];
+            if (t1 > t2)
+                std::swap(t1, t2);
+
+            tMin = std::max(tMin, t1);
+            tMax = std::min(tMax, t2);
+
+            if (tMin > tMax)
+                return false;
+        }
+
+        fraction = tMin;
+        return true;
+    }
+
+private:
+    glm::vec2 start_;
+    glm::vec2 delta_;
+    glm::vec2 invDelta_;
+};
+
+// returns a bit mask of the children with a leaf whose filter collides with the given one
+inline uint32_t collidingChildren(const WideTreeNode& node, const CollisionFilter& filter)
+{
+    uint32_t mask{};
+    for (uint32_t i = 0; i < WideTreeNode::Width; i++)
+    {
+        const auto hit =
+                ((node.categoryBits[i] & filter.maskBits) != 0) &
+                ((filter.categoryBits & node.maskBits[i]) != 0);
+        mask |= static_cast<uint32_t>(hit) << i;
+    }
+    return mask;
+}
+
+} // namespace detail
+
 // ********************************************************
 
 template<typename Callback>
 void DynamicTree::walkTree(const Callback& callback) const
 {
+    if (rootIndex_ == TreeNode::NullNode)
+        return;
+
     StaticVector<uint32_t, TreeQueryStackSize> stack;
 
     stack.emplace_back(rootIndex_);
@@ -111,8 +369,8 @@ void DynamicTree::walkTree(const Callback& callback) const
 
         if (!node.isLeaf())
         {
-            stack.emplace_back(node.left);
             stack.emplace_back(node.right);
+            stack.emplace_back(node.left);
         }
     }
 }
@@ -120,6 +378,73 @@ void DynamicTree::walkTree(const Callback& callback) const
 template<typename Callback>
 void DynamicTree::query(const AABB& aabb, const Callback& callback) const
 {
+    if (wideNodesValid_)
+        queryWide(aabb, nullptr, callback);
+    else
+        queryBinary(aabb, nullptr, callback);
+}
+
+template<typename Callback>
+void DynamicTree::query(const AABB& aabb, const CollisionFilter& filter, const Callback& callback) const
+{
+    if (wideNodesValid_)
+        queryWide(aabb, &filter, callback);
+    else
+        queryBinary(aabb, &filter, callback);
+}
+
+template<typename Callback>
+void DynamicTree::queryWide(const AABB& aabb, const CollisionFilter* filter, const Callback& callback) const
+{
+    if (wideRootIndex_ == TreeNode::NullNode)
+        return;
+
+    const detail::WideQueryBox box{aabb};
+
+    StaticVector<uint32_t, TreeQueryStackSize> stack;
+
+    stack.emplace_back(wideRootIndex_);
+
+    while (!stack.empty())
+    {
+        const auto index = stack.back();
+        stack.pop_back();
+
+        const WideTreeNode& node = wideNodes_[index];
+
+        auto mask = box.intersects(node);
+        if (filter)
+            mask &= detail::collidingChildren(node, *filter);
+
+        while (mask)
+        {
+            const auto slot = static_cast<uint32_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+
+            const auto child = node.children[slot];
+            if (child & WideTreeNode::LeafFlag)
+            {
+                const AABB leafAabb{
+                    .topLeft = {node.min[slot], node.min[slot + WideTreeNode::Width]},
+                    .bottomRight = {node.max[slot], node.max[slot + WideTreeNode::Width]},
+                };
+                if (!callback(node.entities[slot], leafAabb))
+                    return;
+            }
+            else
+            {
+                stack.emplace_back(child);
+            }
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicTree::queryBinary(const AABB& aabb, const CollisionFilter* filter, const Callback& callback) const
+{
+    if (rootIndex_ == TreeNode::NullNode)
+        return;
+
     StaticVector<uint32_t, TreeQueryStackSize> stack;
 
     stack.emplace_back(rootIndex_);
@@ -131,20 +456,144 @@ void DynamicTree::query(const AABB& aabb, const Callback& callback) const
 
         const TreeNode& node = nodes_[index];
 
+        if (filter && !filter->collides(node.filter))
+            continue;
+
         if (intersects(aabb, node.aabb))
         {
             if (node.isLeaf())
             {
-                if (!callback(node.entity, node.aabb))
+                if (!callback(nodeInfos_[index].entity, node.aabb))
                     return;
             }
             else
             {
-                stack.emplace_back(node.left);
+                // the left child is visited first, it follows the node in memory after relayout()
                 stack.emplace_back(node.right);
+                stack.emplace_back(node.left);
             }
         }
     }
 }
 
+template<typename Callback>
+void DynamicTree::queryPairs(std::span<const uint32_t> moved, const Callback& callback)
+{
+    if (rootIndex_ == TreeNode::NullNode || moved.empty())
+        return;
+
+    setMoved(moved, true);
+
+    StaticVector<std::pair<uint32_t, uint32_t>, TreeQueryStackSize> stack;
+
+    stack.emplace_back(rootIndex_, rootIndex_);
+
+    while (!stack.empty())
+    {
+        const auto [lhsIndex, rhsIndex] = stack.back();
+        stack.pop_back();
+
+        const TreeNode& lhs = nodes_[lhsIndex];
+        const TreeNode& rhs = nodes_[rhsIndex];
+
+        // nothing to report between sub trees without moved leaves
+        if (!nodeInfos_[lhsIndex].moved && !nodeInfos_[rhsIndex].moved)
+            continue;
+
+        // no leaf of one sub tree collides with any leaf of the other one
+        if (!lhs.filter.collides(rhs.filter))
+            continue;
+
+        if (lhsIndex == rhsIndex)
+        {
+            // the pairs of a sub tree are the pairs within each child plus the pairs between both children
+            if (!lhs.isLeaf())
+            {
+                stack.emplace_back(lhs.left, lhs.right);
+                stack.emplace_back(lhs.left, lhs.left);
+                stack.emplace_back(lhs.right, lhs.right);
+            }
+            continue;
+        }
+
+        if (!intersects(lhs.aabb, rhs.aabb))
+            continue;
+
+        if (lhs.isLeaf() && rhs.isLeaf())
+        {
+            if (!callback(nodeInfos_[lhsIndex].entity, nodeInfos_[rhsIndex].entity))
+                break;
+        }
+        else if (rhs.isLeaf() || (!lhs.isLeaf() && area(lhs.aabb) >= area(rhs.aabb)))
+        {
+            // descend into the larger node
+            stack.emplace_back(lhs.left, rhsIndex);
+            stack.emplace_back(lhs.right, rhsIndex);
+        }
+        else
+        {
+            stack.emplace_back(lhsIndex, rhs.left);
+            stack.emplace_back(lhsIndex, rhs.right);
+        }
+    }
+
+    setMoved(moved, false);
+}
+
+template<typename Callback>
+float DynamicTree::rayCast(const Line& segment, float maxFraction, const Callback& callback) const
+{
+    if (rootIndex_ == TreeNode::NullNode)
+        return maxFraction;
+
+    const detail::RaySlab slab{segment};
+
+    // nodes are pushed with the fraction where the segment enters them, it is checked again when the segment was
+    // clipped in between
+    StaticVector<std::pair<uint32_t, float>, TreeQueryStackSize> stack;
+
+    if (float fraction{}; slab.enters(nodes_[rootIndex_].aabb, maxFraction, fraction))
+        stack.emplace_back(rootIndex_, fraction);
+
+    while (!stack.empty())
+    {
+        const auto [index, entry] = stack.back();
+        stack.pop_back();
+
+        if (entry > maxFraction)
+            continue;
+
+        const TreeNode& node = nodes_[index];
+
+        if (node.isLeaf())
+        {
+            maxFraction = callback(nodeInfos_[index].entity, maxFraction);
+            if (maxFraction <= 0.0f)
+                return 0.0f;
+            continue;
+        }
+
+        float leftEntry{};
+        float rightEntry{};
+        const auto left = slab.enters(nodes_[node.left].aabb, maxFraction, leftEntry);
+        const auto right = slab.enters(nodes_[node.right].aabb, maxFraction, rightEntry);
+
+        // the nearer child is popped first
+        if (left && right && leftEntry < rightEntry)
+        {
+            stack.emplace_back(node.right, rightEntry);
+            stack.emplace_back(node.left, leftEntry);
+        }
+        else
+        {
+            if (left)
+                stack.emplace_back(node.left, leftEntry);
+            if (right)
+                stack.emplace_back(node.right, rightEntry);
+        }
+    }
+
+    return maxFraction;
+}
+
 } // namespace ngn
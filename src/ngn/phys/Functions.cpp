@@ -5,13 +5,14 @@
 
 #include "Shapes.hpp"
 #include "CommonComponents.hpp"
+#include <cassert>
 
 namespace ngn {
 
 namespace {
 
 template<typename... Trans>
-inline Shape transformIntern(Shape shape, Trans&&... trans)
+inline Shape transformIntern(Shape shape, glm::vec2* polygonVertices, Trans&&... trans)
 {
     switch (shape.type)
     {
@@ -46,6 +47,32 @@ inline Shape transformIntern(Shape shape, Trans&&... trans)
             break;
         }
 
+        case Box:
+        {
+            auto& b = shape.box;
+            b.center = transform(b.center, std::forward<Trans>(trans)...);
+            if constexpr (sizeof...(Trans) >= 3)
+            {
+                // scaled along the local axes, which keeps boxes aligned to them a box
+                const auto args = std::make_tuple(std::forward<Trans>(trans)...);
+                const auto& rot = std::get<1>(args);
+                const auto& sca = std::get<2>(args);
+                b.halfExtents *= glm::abs(sca.value);
+                b.axis = rotate(b.axis, rot.dir);
+            }
+            break;
+        }
+
+        case ConvexPolygon:
+        {
+            auto& p = shape.polygon;
+            assert(polygonVertices);
+            for (uint32_t i = 0; i < p.count; i++)
+                polygonVertices[i] = transform(p.vertices[i], std::forward<Trans>(trans)...);
+            p.vertices = polygonVertices;
+            break;
+        }
+
         case Invalid:
             break;
     }
@@ -79,6 +106,34 @@ AABB calculateAABB(const Line& line)
     };
 }
 
+AABB calculateAABB(const Box& box)
+{
+    const auto extent =
+            glm::abs(box.axis.x) * glm::vec2{box.halfExtents.x, box.halfExtents.y} +
+            glm::abs(box.axis.y) * glm::vec2{box.halfExtents.y, box.halfExtents.x};
+
+    return {
+        .topLeft = box.center - extent,
+        .bottomRight = box.center + extent,
+    };
+}
+
+AABB calculateAABB(const ConvexPolygon& polygon)
+{
+    AABB aabb{
+        .topLeft = polygon.vertices[0],
+        .bottomRight = polygon.vertices[0],
+    };
+
+    for (uint32_t i = 1; i < polygon.count; i++)
+    {
+        aabb.topLeft = glm::min(aabb.topLeft, polygon.vertices[i]);
+        aabb.bottomRight = glm::max(aabb.bottomRight, polygon.vertices[i]);
+    }
+
+    return aabb;
+}
+
 AABB calculateAABB(const Shape& shape)
 {
     AABB aabb;
@@ -96,6 +151,12 @@ AABB calculateAABB(const Shape& shape)
         case Line:
             return calculateAABB(shape.line);
 
+        case Box:
+            return calculateAABB(shape.box);
+
+        case ConvexPolygon:
+            return calculateAABB(shape.polygon);
+
         case Invalid:
             break;
     }
@@ -153,14 +214,14 @@ glm::vec2 transform(glm::vec2 vec, const Position& pos, const Rotation& rot, con
     return vec;
 }
 
-Shape transform(Shape shape, const Position& pos)
+Shape transform(Shape shape, const Position& pos, glm::vec2* polygonVertices)
 {
-    return transformIntern(std::move(shape), pos);
+    return transformIntern(std::move(shape), polygonVertices, pos);
 }
 
-Shape transform(Shape shape, const Position& pos, const Rotation& rot, const Scale& sca)
+Shape transform(Shape shape, const Position& pos, const Rotation& rot, const Scale& sca, glm::vec2* polygonVertices)
 {
-    return transformIntern(std::move(shape), pos, rot, sca);
+    return transformIntern(std::move(shape), polygonVertices, pos, rot, sca);
 }
 
 } // namespace ngn
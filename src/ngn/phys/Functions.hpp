@@ -8,8 +8,10 @@
 namespace ngn {
 
 class AABB;
+class Box;
 class Circle;
 class Capsule;
+class ConvexPolygon;
 class Line;
 class Position;
 class Rotation;
@@ -19,6 +21,8 @@ class Shape;
 AABB calculateAABB(const Circle& circle);
 AABB calculateAABB(const Capsule& capsule);
 AABB calculateAABB(const Line& line);
+AABB calculateAABB(const Box& box);
+AABB calculateAABB(const ConvexPolygon& polygon);
 AABB calculateAABB(const Shape& shape);
 bool contains(const AABB& lhs, const AABB& rhs);
 AABB combine(const AABB& one, const AABB& two);
@@ -27,8 +31,10 @@ float area(const AABB& aabb);
 glm::vec2 rotate(const glm::vec2& vec, const glm::vec2& dir);
 glm::vec2 transform(glm::vec2 vec, const Position& pos);
 glm::vec2 transform(glm::vec2 vec, const Position& pos, const Rotation& rot, const Scale& sca);
-Shape transform(Shape shape, const Position& pos);
-Shape transform(Shape shape, const Position& pos, const Rotation& rot, const Scale& sca);
+// Polygons are transformed into polygonVertices, which must hold as many vertices as the polygon, and point to them.
+Shape transform(Shape shape, const Position& pos, glm::vec2* polygonVertices = nullptr);
+Shape transform(Shape shape, const Position& pos, const Rotation& rot, const Scale& sca,
+                glm::vec2* polygonVertices = nullptr);
 
 } // namespace ngn
 
@@ -0,0 +1,481 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "GridBroadphase.hpp"
+
+#include "DynamicTree.hpp"
+#include "phys/CollisionTests.hpp"
+#include "phys/Functions.hpp"
+#include <bit>
+#include <entt/entt.hpp>
+#include <immintrin.h>
+
+namespace ngn {
+
+namespace {
+
+// cell coordinates are clamped to 16 bit to pack both into the cell key
+constexpr float CellMin = -32768.0f;
+constexpr float CellMax = 32767.0f;
+
+// queries covering more cells than this many per object scan all objects instead
+constexpr uint32_t QueryCellsPerObject = 4;
+
+constexpr uint32_t cellKey(int32_t x, int32_t y)
+{
+    return (static_cast<uint32_t>(static_cast<uint16_t>(x)) << 16) | static_cast<uint16_t>(y);
+}
+
+} // namespace
+
+GridBroadphase::GridBroadphase(float cellSize) :
+    cellSize_{cellSize},
+    invCellSize_{1.0f / cellSize},
+    bucketShift_{31},
+    dirty_{}
+{
+    assert(cellSize > 0.0f);
+
+    bucketOffsets_.assign(3, 0);
+}
+
+uint32_t GridBroadphase::addObject(const AABB& aabb, entt::entity entity, const CollisionFilter& filter)
+{
+    uint32_t objectId{};
+
+    if (!freeObjects_.empty())
+    {
+        objectId = freeObjects_.back();
+        freeObjects_.pop_back();
+    }
+    else
+    {
+        objectId = static_cast<uint32_t>(fatAABBs_.size());
+        fatAABBs_.emplace_back();
+        filters_.emplace_back();
+        entities_.emplace_back();
+        moved_.emplace_back();
+    }
+
+    fatAABBs_[objectId] = enlargeAABB(aabb);
+    filters_[objectId] = filter;
+    entities_[objectId] = entity;
+
+    dirty_ = true;
+
+    return objectId;
+}
+
+bool GridBroadphase::updateObject(uint32_t objectId, const AABB& aabb)
+{
+    assert(objectId < fatAABBs_.size() && isLive(objectId));
+
+    if (contains(fatAABBs_[objectId], aabb))
+        return false;
+
+    fatAABBs_[objectId] = enlargeAABB(aabb);
+
+    dirty_ = true;
+
+    return true;
+}
+
+void GridBroadphase::removeObject(uint32_t objectId)
+{
+    assert(objectId < fatAABBs_.size() && isLive(objectId));
+
+    entities_[objectId] = entt::null;
+    freeObjects_.push_back(objectId);
+
+    dirty_ = true;
+}
+
+void GridBroadphase::finishUpdate()
+{
+    if (dirty_)
+        rebuild();
+}
+
+void GridBroadphase::queryPairs(std::span<const uint32_t> moved, const PairCallback& callback)
+{
+    if (moved.empty())
+        return;
+
+    if (dirty_)
+        rebuild();
+
+    for (const auto objectId : moved)
+        moved_[objectId] = true;
+
+    const auto report = [&](uint32_t objectId)
+    {
+        const auto& range = cellRanges_[objectId];
+        const auto& aabb = fatAABBs_[objectId];
+        const auto& filter = filters_[objectId];
+
+        for (int32_t y = range.minY; y <= range.maxY; y++)
+        {
+            for (int32_t x = range.minX; x <= range.maxX; x++)
+            {
+                const auto cell = cellKey(x, y);
+                const auto bucketIndex = bucket(cell);
+
+                for (auto i = bucketOffsets_[bucketIndex]; i < bucketOffsets_[bucketIndex + 1]; i++)
+                {
+                    const auto& entry = entries_[i];
+                    if (entry.cell != cell || entry.object == objectId)
+                        continue;
+
+                    // a pair of two moved objects is reported by the one with the lower id
+                    if (moved_[entry.object] && entry.object < objectId)
+                        continue;
+
+                    // objects sharing several cells are reported in the first of them only
+                    const auto& otherRange = cellRanges_[entry.object];
+                    if (std::max(range.minX, otherRange.minX) != x || std::max(range.minY, otherRange.minY) != y)
+                        continue;
+
+                    if (!filter.collides(filters_[entry.object]) || !intersects(aabb, fatAABBs_[entry.object]))
+                        continue;
+
+                    if (!callback(entities_[objectId], entities_[entry.object]))
+                        return false;
+                }
+            }
+        }
+
+        return true;
+    };
+
+    for (const auto objectId : moved)
+    {
+        if (!report(objectId))
+            break;
+    }
+
+    for (const auto objectId : moved)
+        moved_[objectId] = false;
+}
+
+void GridBroadphase::query(const AABB& aabb, const QueryCallback& callback) const
+{
+    const auto range = cellRange(aabb);
+    const auto cellCount = static_cast<uint64_t>(range.maxX - range.minX + 1) *
+                           static_cast<uint64_t>(range.maxY - range.minY + 1);
+
+    // the buckets are outdated or walking them would visit more entries than there are objects
+    if (dirty_ || cellCount > QueryCellsPerObject * fatAABBs_.size())
+    {
+        for (uint32_t objectId = 0; objectId < fatAABBs_.size(); objectId++)
+        {
+            if (isLive(objectId) && intersects(aabb, fatAABBs_[objectId]))
+            {
+                if (!callback(entities_[objectId], fatAABBs_[objectId]))
+                    return;
+            }
+        }
+        return;
+    }
+
+    for (int32_t y = range.minY; y <= range.maxY; y++)
+    {
+        for (int32_t x = range.minX; x <= range.maxX; x++)
+        {
+            const auto cell = cellKey(x, y);
+            const auto bucketIndex = bucket(cell);
+
+            for (auto i = bucketOffsets_[bucketIndex]; i < bucketOffsets_[bucketIndex + 1]; i++)
+            {
+                const auto& entry = entries_[i];
+                if (entry.cell != cell)
+                    continue;
+
+                const auto& objectRange = cellRanges_[entry.object];
+                if (std::max(range.minX, objectRange.minX) != x || std::max(range.minY, objectRange.minY) != y)
+                    continue;
+
+                if (!intersects(aabb, fatAABBs_[entry.object]))
+                    continue;
+
+                if (!callback(entities_[entry.object], fatAABBs_[entry.object]))
+                    return;
+            }
+        }
+    }
+}
+
+float GridBroadphase::rayCast(const Line& segment, float maxFraction, const RayCastCallback& callback) const
+{
+    const detail::RaySlab slab{segment};
+
+    const auto castObject = [&](uint32_t objectId)
+    {
+        float fraction{};
+        if (!slab.enters(fatAABBs_[objectId], maxFraction, fraction))
+            return true;
+
+        maxFraction = callback(entities_[objectId], maxFraction);
+        return maxFraction > 0.0f;
+    };
+
+    const auto delta = segment.end - segment.start;
+    const auto end = segment.start + delta * maxFraction;
+    const auto bounds = cellRange(AABB{glm::min(segment.start, end), glm::max(segment.start, end)});
+
+    // the cells of the segment would not match the clamped ranges of the objects outside of the grid
+    const auto clamped = [](int32_t value)
+    {
+        return value == static_cast<int32_t>(CellMin) || value == static_cast<int32_t>(CellMax);
+    };
+
+    if (dirty_ || clamped(bounds.minX) || clamped(bounds.minY) || clamped(bounds.maxX) || clamped(bounds.maxY))
+    {
+        for (uint32_t objectId = 0; objectId < fatAABBs_.size(); objectId++)
+        {
+            if (isLive(objectId) && !castObject(objectId))
+                return 0.0f;
+        }
+        return maxFraction;
+    }
+
+    // walk the cells along the segment in order (Amanatides and Woo), the fractions are relative to the segment
+    auto x = static_cast<int32_t>(std::floor(segment.start.x * invCellSize_));
+    auto y = static_cast<int32_t>(std::floor(segment.start.y * invCellSize_));
+
+    const int32_t stepX = delta.x > 0.0f ? 1 : -1;
+    const int32_t stepY = delta.y > 0.0f ? 1 : -1;
+
+    const auto firstBoundary = [this](int32_t cell, int32_t step, float start, float distance)
+    {
+        if (distance == 0.0f)
+            return std::numeric_limits<float>::infinity();
+        const auto boundary = static_cast<float>(step > 0 ? cell + 1 : cell) * cellSize_;
+        return (boundary - start) / distance;
+    };
+
+    auto nextX = firstBoundary(x, stepX, segment.start.x, delta.x);
+    auto nextY = firstBoundary(y, stepY, segment.start.y, delta.y);
+    const auto fractionX = delta.x != 0.0f ? cellSize_ / std::abs(delta.x) : std::numeric_limits<float>::infinity();
+    const auto fractionY = delta.y != 0.0f ? cellSize_ / std::abs(delta.y) : std::numeric_limits<float>::infinity();
+
+    int32_t previousX{};
+    int32_t previousY{};
+    bool first = true;
+    float entry = 0.0f;
+
+    while (entry <= maxFraction)
+    {
+        const auto cell = cellKey(x, y);
+        const auto bucketIndex = bucket(cell);
+
+        for (auto i = bucketOffsets_[bucketIndex]; i < bucketOffsets_[bucketIndex + 1]; i++)
+        {
+            const auto& cellEntry = entries_[i];
+            if (cellEntry.cell != cell)
+                continue;
+
+            // the segment crosses the cells of an object in one run, it was cast in the previous cell already
+            if (!first && cellRanges_[cellEntry.object].contains(previousX, previousY))
+                continue;
+
+            if (!castObject(cellEntry.object))
+                return 0.0f;
+        }
+
+        previousX = x;
+        previousY = y;
+        first = false;
+
+        if (nextX < nextY)
+        {
+            entry = nextX;
+            nextX += fractionX;
+            x += stepX;
+        }
+        else
+        {
+            entry = nextY;
+            nextY += fractionY;
+            y += stepY;
+        }
+    }
+
+    return maxFraction;
+}
+
+void GridBroadphase::walkBounds(const BoundsCallback& callback) const
+{
+    for (uint32_t objectId = 0; objectId < fatAABBs_.size(); objectId++)
+    {
+        if (isLive(objectId))
+            callback(fatAABBs_[objectId], true);
+    }
+
+    if (dirty_)
+        return;
+
+    const auto bucketCount = static_cast<uint32_t>(bucketOffsets_.size()) - 1;
+    for (uint32_t bucketIndex = 0; bucketIndex < bucketCount; bucketIndex++)
+    {
+        const auto begin = bucketOffsets_[bucketIndex];
+        const auto end = bucketOffsets_[bucketIndex + 1];
+
+        for (auto i = begin; i < end; i++)
+        {
+            const auto cell = entries_[i].cell;
+
+            // report every occupied cell once
+            bool seen = false;
+            for (auto j = begin; j < i && !seen; j++)
+                seen = entries_[j].cell == cell;
+            if (seen)
+                continue;
+
+            const glm::vec2 topLeft{
+                static_cast<float>(static_cast<int16_t>(cell >> 16)) * cellSize_,
+                static_cast<float>(static_cast<int16_t>(cell & 0xFFFF)) * cellSize_,
+            };
+            callback(AABB{topLeft, topLeft + glm::vec2{cellSize_}}, false);
+        }
+    }
+}
+
+BroadphaseStats GridBroadphase::stats() const
+{
+    BroadphaseStats stats{
+        .objectCount = static_cast<uint32_t>(fatAABBs_.size() - freeObjects_.size()),
+        .nodeCount = static_cast<uint32_t>(entries_.size()),
+    };
+
+    uint32_t usedBuckets{};
+
+    const auto bucketCount = static_cast<uint32_t>(bucketOffsets_.size()) - 1;
+    for (uint32_t bucketIndex = 0; bucketIndex < bucketCount; bucketIndex++)
+    {
+        const auto size = bucketOffsets_[bucketIndex + 1] - bucketOffsets_[bucketIndex];
+        if (size == 0)
+            continue;
+
+        usedBuckets++;
+        stats.depth = std::max(stats.depth, size);
+    }
+
+    if (usedBuckets > 0)
+        stats.cost = static_cast<float>(entries_.size()) / static_cast<float>(usedBuckets);
+
+    return stats;
+}
+
+void GridBroadphase::rebuild()
+{
+    updateCellRanges();
+
+    const auto objectCount = static_cast<uint32_t>(fatAABBs_.size());
+
+    const auto forEachCell = [this, objectCount](const auto& function)
+    {
+        for (uint32_t objectId = 0; objectId < objectCount; objectId++)
+        {
+            if (!isLive(objectId))
+                continue;
+
+            const auto& range = cellRanges_[objectId];
+            for (int32_t y = range.minY; y <= range.maxY; y++)
+            {
+                for (int32_t x = range.minX; x <= range.maxX; x++)
+                    function(cellKey(x, y), objectId);
+            }
+        }
+    };
+
+    uint32_t entryCount{};
+    for (uint32_t objectId = 0; objectId < objectCount; objectId++)
+    {
+        if (!isLive(objectId))
+            continue;
+
+        const auto& range = cellRanges_[objectId];
+        entryCount += static_cast<uint32_t>((range.maxX - range.minX + 1) * (range.maxY - range.minY + 1));
+    }
+
+    // about one cell per bucket, the shift keeps the top bits of the multiplicative hash
+    const auto bucketCount = std::max(2U, std::bit_ceil(entryCount));
+    bucketShift_ = 32 - static_cast<uint32_t>(std::countr_zero(bucketCount));
+
+    // counting sort of the entries by bucket
+    bucketOffsets_.assign(bucketCount + 1, 0);
+    forEachCell([this](uint32_t cell, uint32_t) { bucketOffsets_[bucket(cell) + 1]++; });
+
+    for (uint32_t i = 1; i <= bucketCount; i++)
+        bucketOffsets_[i] += bucketOffsets_[i - 1];
+
+    bucketCursors_.assign(bucketOffsets_.begin(), bucketOffsets_.end() - 1);
+    entries_.resize(entryCount);
+    forEachCell([this](uint32_t cell, uint32_t objectId)
+    {
+        entries_[bucketCursors_[bucket(cell)]++] = CellEntry{cell, objectId};
+    });
+
+    dirty_ = false;
+}
+
+void GridBroadphase::updateCellRanges()
+{
+    static_assert(sizeof(AABB) == 4 * sizeof(float) && sizeof(CellRange) == sizeof(AABB));
+
+    cellRanges_.resize(fatAABBs_.size());
+
+    std::size_t i{};
+
+#if defined(__AVX2__)
+    // two boxes per iteration, the same scale, floor and clamp for all four coordinates
+    const auto scale = _mm256_set1_ps(invCellSize_);
+    const auto lower = _mm256_set1_ps(CellMin);
+    const auto upper = _mm256_set1_ps(CellMax);
+
+    for (; i + 2 <= fatAABBs_.size(); i += 2)
+    {
+        const auto bounds = _mm256_loadu_ps(reinterpret_cast<const float*>(fatAABBs_.data() + i));
+        const auto cells = _mm256_min_ps(_mm256_max_ps(_mm256_floor_ps(_mm256_mul_ps(bounds, scale)), lower), upper);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(cellRanges_.data() + i), _mm256_cvttps_epi32(cells));
+    }
+#endif
+
+    for (; i < fatAABBs_.size(); i++)
+        cellRanges_[i] = cellRange(fatAABBs_[i]);
+}
+
+GridBroadphase::CellRange GridBroadphase::cellRange(const AABB& aabb) const
+{
+    const auto toCell = [this](float value)
+    {
+        return static_cast<int32_t>(std::clamp(std::floor(value * invCellSize_), CellMin, CellMax));
+    };
+
+    return CellRange{
+        .minX = toCell(aabb.topLeft.x),
+        .minY = toCell(aabb.topLeft.y),
+        .maxX = toCell(aabb.bottomRight.x),
+        .maxY = toCell(aabb.bottomRight.y),
+    };
+}
+
+uint32_t GridBroadphase::bucket(uint32_t cell) const
+{
+    // Fibonacci hashing, neighbouring cells end up in different buckets
+    return (cell * 0x9E3779B9U) >> bucketShift_;
+}
+
+AABB GridBroadphase::enlargeAABB(AABB aabb) const
+{
+    // same margin as the tree, so switching the backend does not change the update rate
+    aabb.extend(glm::vec2{10.f});
+    return aabb;
+}
+
+bool GridBroadphase::isLive(uint32_t objectId) const
+{
+    return entities_[objectId] != entt::null;
+}
+
+} // namespace ngn
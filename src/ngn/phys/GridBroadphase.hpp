@@ -0,0 +1,101 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Broadphase.hpp"
+#include "Collision.hpp"
+#include "Macros.hpp"
+#include "Shapes.hpp"
+#include <entt/fwd.hpp>
+#include <vector>
+
+namespace ngn {
+
+// Uniform grid of square cells. Every object is entered into all cells its enlarged bounds touch. The cells are hashed
+// into buckets whose entries are kept in one flat array, which is rebuilt by a counting sort whenever objects changed.
+class GridBroadphase final : public Broadphase
+{
+public:
+    explicit GridBroadphase(float cellSize);
+
+    uint32_t addObject(const AABB& aabb, entt::entity entity, const CollisionFilter& filter) override;
+    bool updateObject(uint32_t objectId, const AABB& aabb) override;
+    void removeObject(uint32_t objectId) override;
+
+    const AABB& fatAABB(uint32_t objectId) const override
+    {
+        assert(objectId < fatAABBs_.size());
+        return fatAABBs_[objectId];
+    }
+
+    entt::entity entity(uint32_t objectId) const override
+    {
+        assert(objectId < entities_.size());
+        return entities_[objectId];
+    }
+
+    void finishUpdate() override;
+
+    void queryPairs(std::span<const uint32_t> moved, const PairCallback& callback) override;
+    void query(const AABB& aabb, const QueryCallback& callback) const override;
+    float rayCast(const Line& segment, float maxFraction, const RayCastCallback& callback) const override;
+
+    void walkBounds(const BoundsCallback& callback) const override;
+
+    BroadphaseStats stats() const override;
+
+private:
+    // inclusive range of cell coordinates, same layout as AABB to convert both at once
+    class CellRange
+    {
+    public:
+        int32_t minX;
+        int32_t minY;
+        int32_t maxX;
+        int32_t maxY;
+
+        bool contains(int32_t x, int32_t y) const { return x >= minX && x <= maxX && y >= minY && y <= maxY; }
+    };
+
+    class CellEntry
+    {
+    public:
+        uint32_t cell;
+        uint32_t object;
+    };
+
+private:
+    void rebuild();
+    void updateCellRanges();
+    CellRange cellRange(const AABB& aabb) const;
+    uint32_t bucket(uint32_t cell) const;
+
+    AABB enlargeAABB(AABB aabb) const;
+    bool isLive(uint32_t objectId) const;
+
+private:
+    float cellSize_;
+    float invCellSize_;
+
+    std::vector<AABB> fatAABBs_;
+    std::vector<CollisionFilter> filters_;
+    // entt::null for objects in the free list
+    std::vector<entt::entity> entities_;
+    std::vector<CellRange> cellRanges_;
+    std::vector<uint32_t> freeObjects_;
+    std::vector<uint8_t> moved_;
+
+    // entries of bucket i are entries_[bucketOffsets_[i], bucketOffsets_[i + 1])
+    std::vector<uint32_t> bucketOffsets_;
+    std::vector<uint32_t> bucketCursors_;
+    std::vector<CellEntry> entries_;
+    uint32_t bucketShift_;
+
+    // objects changed since the buckets were built
+    bool dirty_;
+
+    NGN_DISABLE_COPY_MOVE(GridBroadphase)
+};
+
+} // namespace ngn
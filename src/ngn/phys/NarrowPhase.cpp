@@ -0,0 +1,127 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "NarrowPhase.hpp"
+
+#include "CollisionTests.hpp"
+#include "JobSystem.hpp"
+#include "Shapes.hpp"
+
+namespace ngn {
+
+namespace {
+
+// a multiple of the eight pairs tested at once
+constexpr uint32_t ChunkSize = 128;
+
+constexpr auto KernelCount = static_cast<std::size_t>(CollisionKernel::None) + 1;
+
+} // namespace
+
+NarrowPhase::NarrowPhase(JobSystem* jobSystem) :
+    jobSystem_{jobSystem}
+{
+}
+
+NarrowPhase::~NarrowPhase() = default;
+
+NarrowPhaseResultList NarrowPhase::run(std::span<const NarrowPhaseTest> tests,
+                                       const LinearAllocator<NarrowPhaseResult>& allocator)
+{
+    const auto testCount = static_cast<uint32_t>(tests.size());
+
+    sortTests(tests);
+
+    // chunk i owns the slot [i * ChunkSize, i * ChunkSize + ChunkSize), no chunk finds more collisions than tests
+    NarrowPhaseResultList results{allocator};
+    results.resize(testCount);
+
+    chunkCounts_.resize((testCount + ChunkSize - 1) / ChunkSize);
+
+    auto* slots = results.data();
+    jobSystem_->parallelFor(testCount, ChunkSize, [this, tests, slots](uint32_t begin, uint32_t end, uint32_t)
+    {
+        processChunk(tests, begin, end, slots + begin);
+    });
+
+    // compact in chunk order, every slot moves to the front only
+
+    std::size_t resultCount{};
+    for (std::size_t chunk = 0; chunk < chunkCounts_.size(); chunk++)
+    {
+        const auto* slot = slots + chunk * ChunkSize;
+        std::copy(slot, slot + chunkCounts_[chunk], slots + resultCount);
+        resultCount += chunkCounts_[chunk];
+    }
+    results.resize(resultCount);
+
+    // back from kernel order to test order
+    std::sort(results.begin(), results.end(), [](const NarrowPhaseResult& lhs, const NarrowPhaseResult& rhs)
+    {
+        return lhs.test < rhs.test;
+    });
+
+    return results;
+}
+
+void NarrowPhase::sortTests(std::span<const NarrowPhaseTest> tests)
+{
+    // counting sort, the tests of one kernel keep their order
+
+    std::size_t offsets[KernelCount + 1]{};
+    for (const auto& test : tests)
+        offsets[static_cast<std::size_t>(collisionKernel(*test.shapeA, *test.shapeB)) + 1]++;
+
+    for (std::size_t kernel = 1; kernel <= KernelCount; kernel++)
+        offsets[kernel] += offsets[kernel - 1];
+
+    order_.resize(tests.size());
+    for (uint32_t index = 0; index < tests.size(); index++)
+    {
+        const auto& test = tests[index];
+        order_[offsets[static_cast<std::size_t>(collisionKernel(*test.shapeA, *test.shapeB))]++] = index;
+    }
+}
+
+void NarrowPhase::processChunk(std::span<const NarrowPhaseTest> tests, uint32_t begin, uint32_t end,
+                               NarrowPhaseResult* results)
+{
+    const Shape* shapesA[ChunkSize];
+    const Shape* shapesB[ChunkSize];
+    Collision collisions[ChunkSize];
+
+    const auto count = end - begin;
+    for (uint32_t index = 0; index < count; index++)
+    {
+        const auto& test = tests[order_[begin + index]];
+        shapesA[index] = test.shapeA;
+        shapesB[index] = test.shapeB;
+        collisions[index] = Collision{.pair = test.pair};
+    }
+
+    // one batch per run of tests with the same kernel
+    for (uint32_t first = 0; first < count;)
+    {
+        const auto kernel = collisionKernel(*shapesA[first], *shapesB[first]);
+
+        auto last = first + 1;
+        while (last < count && collisionKernel(*shapesA[last], *shapesB[last]) == kernel)
+            last++;
+
+        const auto size = last - first;
+        testCollisions(kernel, {shapesA + first, size}, {shapesB + first, size}, {collisions + first, size});
+
+        first = last;
+    }
+
+    uint32_t resultCount{};
+    for (uint32_t index = 0; index < count; index++)
+    {
+        if (collisions[index].colliding)
+            results[resultCount++] = NarrowPhaseResult{.test = order_[begin + index], .collision = collisions[index]};
+    }
+
+    chunkCounts_[begin / ChunkSize] = resultCount;
+}
+
+} // namespace ngn
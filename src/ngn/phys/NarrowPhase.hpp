@@ -0,0 +1,65 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Allocators.hpp"
+#include "Collision.hpp"
+#include "Macros.hpp"
+#include <span>
+#include <vector>
+
+namespace ngn {
+
+class JobSystem;
+class Shape;
+
+class NarrowPhaseTest
+{
+public:
+    CollisionPair pair;
+    const Shape* shapeA;
+    const Shape* shapeB;
+};
+
+class NarrowPhaseResult
+{
+public:
+    // index into the tests passed to NarrowPhase::run()
+    uint32_t test;
+    Collision collision;
+};
+
+using NarrowPhaseResultList = std::vector<NarrowPhaseResult, LinearAllocator<NarrowPhaseResult>>;
+
+// Runs the narrow phase tests in chunks on the job system. The tests are sorted by their shape types first, so the
+// chunks run the batched tests of testCollisions(). The result list is sized for all tests up front and every chunk
+// writes the collisions it finds into its own slot of it, so no thread ever allocates. The slots are compacted in
+// chunk order and sorted by test, so the result does not depend on the scheduling.
+class NarrowPhase
+{
+public:
+    explicit NarrowPhase(JobSystem* jobSystem);
+    ~NarrowPhase();
+
+    // returns the colliding tests in the order of the tests
+    NarrowPhaseResultList run(std::span<const NarrowPhaseTest> tests,
+                              const LinearAllocator<NarrowPhaseResult>& allocator);
+
+private:
+    void sortTests(std::span<const NarrowPhaseTest> tests);
+    void processChunk(std::span<const NarrowPhaseTest> tests, uint32_t begin, uint32_t end,
+                      NarrowPhaseResult* results);
+
+private:
+    JobSystem* jobSystem_;
+
+    // number of collisions each chunk wrote to its slot
+    std::vector<uint32_t> chunkCounts_;
+    // test indices sorted by kernel
+    std::vector<uint32_t> order_;
+
+    NGN_DISABLE_COPY_MOVE(NarrowPhase)
+};
+
+} // namespace ngn
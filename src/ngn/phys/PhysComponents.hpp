@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "Collision.hpp"
 #include <glm/glm.hpp>
 
 namespace ngn {
@@ -15,6 +16,9 @@ public:
     float restitution;
     bool sensor;
     bool fastMoving;
+    // false for bodies keeping their velocity, their forces are ignored
+    bool useForce;
+    CollisionFilter filter;
 };
 
 class LinearForce
@@ -41,7 +45,9 @@ public:
     float value{};
 };
 
-class TransformChangedTag
+// Dynamic bodies which have been resting for WorldConfig::timeToSleep, together with all bodies touching them. They
+// are not integrated nor moved in the broadphase until they are woken by a contact, a force or a transform change.
+class SleepingTag
 {
 };
 
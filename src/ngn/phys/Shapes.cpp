@@ -28,4 +28,16 @@ Shape::Shape(Capsule&& c) :
 {
 }
 
+Shape::Shape(Box&& b) :
+    type{Type::Box},
+    box{std::move(b)}
+{
+}
+
+Shape::Shape(ConvexPolygon&& p) :
+    type{Type::ConvexPolygon},
+    polygon{std::move(p)}
+{
+}
+
 } // namespace ngn
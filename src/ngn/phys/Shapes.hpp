@@ -4,6 +4,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <array>
 
 namespace ngn {
 
@@ -45,6 +46,35 @@ public:
     float radius{};
 };
 
+class Box
+{
+public:
+    glm::vec2 center{};
+    glm::vec2 halfExtents{};
+    // unit direction of the first half extent
+    glm::vec2 axis{1, 0};
+
+    // in order around the box
+    inline std::array<glm::vec2, 4> corners() const
+    {
+        const auto x = axis * halfExtents.x;
+        const auto y = glm::vec2{-axis.y, axis.x} * halfExtents.y;
+        return {center + x + y, center - x + y, center - x - y, center + x - y};
+    }
+};
+
+// The vertices are kept out of line so they do not grow every Shape. World copies the ones of a body into its own
+// storage, the array passed to World::createBody() only has to live until the call returns.
+class ConvexPolygon
+{
+public:
+    static constexpr uint32_t MaxVertices = 8;
+
+    // at least three, in order around the polygon in either direction
+    const glm::vec2* vertices{};
+    uint32_t count{};
+};
+
 class Shape
 {
 public:
@@ -54,6 +84,8 @@ public:
         Circle,
         Line,
         Capsule,
+        Box,
+        ConvexPolygon,
     };
 
 public:
@@ -61,6 +93,8 @@ public:
     Shape(Circle&& c);
     Shape(Line&& l);
     Shape(Capsule&& c);
+    Shape(Box&& b);
+    Shape(ConvexPolygon&& p);
 
     Type type;
 
@@ -69,7 +103,12 @@ public:
         Circle circle;
         Line line;
         Capsule capsule;
+        Box box;
+        ConvexPolygon polygon;
     };
 };
 
+// copied for every body and read by the narrow phase for every pair
+static_assert(sizeof(Shape) <= 32);
+
 } // namespace ngn
@@ -3,58 +3,424 @@
 
 #include "Solver.hpp"
 
+#include "Allocators.hpp"
+#include "ChangeSet.hpp"
 #include "CommonComponents.hpp"
+#include "ContactManager.hpp"
+#include "Instrumentation.hpp"
+#include "JobSystem.hpp"
 #include "phys/PhysComponents.hpp"
 #include <entt/entt.hpp>
+#include <immintrin.h>
 
 namespace ngn {
 
-void resolveCollisions(entt::registry* registry, const CollisionList& collisions)
+namespace {
+
+// shared slot of all bodies the solver does not move, its velocity and inverse mass are 0
+constexpr int32_t StaticBody = 0;
+
+constexpr uint32_t MaxColors = 32;
+// contacts which found no free color, they are solved one after the other
+constexpr uint32_t OverflowColor = MaxColors - 1;
+
+constexpr uint32_t BatchSize = 256;
+
+// part of the penetration which is resolved per update
+constexpr float CorrectionPercent = 0.2f;
+
+// bodies approaching slower than this do not bounce, which keeps resting contacts from jittering
+constexpr float RestitutionVelocity = 10.0f;
+
+template<typename T>
+using FrameVector = std::vector<T, LinearAllocator<T>>;
+
+template<typename T>
+FrameVector<T> frameVector(MemoryArena* arena)
 {
-    for (const auto& col : collisions)
+    return FrameVector<T>{LinearAllocator<T>{arena}};
+}
+
+class SolverBodies
+{
+public:
+    explicit SolverBodies(MemoryArena* arena) :
+        entities{frameVector<entt::entity>(arena)},
+        positions{frameVector<Position*>(arena)},
+        velocities{frameVector<LinearVelocity*>(arena)},
+        velocityX{frameVector<float>(arena)},
+        velocityY{frameVector<float>(arena)},
+        invMass{frameVector<float>(arena)},
+        correction{frameVector<glm::vec2>(arena)},
+        colors{frameVector<uint32_t>(arena)}
+    {
+    }
+
+    void add(entt::entity entity, Position* position, LinearVelocity* velocity, float bodyInvMass)
     {
-        resolveCollision(registry, col);
+        entities.push_back(entity);
+        positions.push_back(position);
+        velocities.push_back(velocity);
+        velocityX.push_back(velocity ? velocity->value.x : 0.0f);
+        velocityY.push_back(velocity ? velocity->value.y : 0.0f);
+        invMass.push_back(bodyInvMass);
+        correction.push_back({});
+        colors.push_back(0);
     }
+
+    FrameVector<entt::entity> entities;
+    FrameVector<Position*> positions;
+    FrameVector<LinearVelocity*> velocities;
+
+    FrameVector<float> velocityX;
+    FrameVector<float> velocityY;
+    FrameVector<float> invMass;
+    FrameVector<glm::vec2> correction;
+    // bit mask of the colors of the contacts of the body
+    FrameVector<uint32_t> colors;
+};
+
+class Constraint
+{
+public:
+    uint32_t contact;
+    int32_t bodyA;
+    int32_t bodyB;
+    uint32_t color;
+    glm::vec2 normal;
+    float normalMass;
+    float targetVelocity;
+    float impulse;
+    float penetration;
+};
+
+// the constraints sorted by color, one array per value to load eight of them at once
+class SolverConstraints
+{
+public:
+    SolverConstraints(MemoryArena* arena, std::size_t size) :
+        contact(size, LinearAllocator<uint32_t>{arena}),
+        bodyA(size, LinearAllocator<int32_t>{arena}),
+        bodyB(size, LinearAllocator<int32_t>{arena}),
+        normalX(size, LinearAllocator<float>{arena}),
+        normalY(size, LinearAllocator<float>{arena}),
+        normalMass(size, LinearAllocator<float>{arena}),
+        targetVelocity(size, LinearAllocator<float>{arena}),
+        impulse(size, LinearAllocator<float>{arena}),
+        penetration(size, LinearAllocator<float>{arena})
+    {
+    }
+
+    void set(uint32_t index, const Constraint& constraint)
+    {
+        contact[index] = constraint.contact;
+        bodyA[index] = constraint.bodyA;
+        bodyB[index] = constraint.bodyB;
+        normalX[index] = constraint.normal.x;
+        normalY[index] = constraint.normal.y;
+        normalMass[index] = constraint.normalMass;
+        targetVelocity[index] = constraint.targetVelocity;
+        impulse[index] = constraint.impulse;
+        penetration[index] = constraint.penetration;
+    }
+
+    FrameVector<uint32_t> contact;
+    FrameVector<int32_t> bodyA;
+    FrameVector<int32_t> bodyB;
+    FrameVector<float> normalX;
+    FrameVector<float> normalY;
+    FrameVector<float> normalMass;
+    FrameVector<float> targetVelocity;
+    FrameVector<float> impulse;
+    FrameVector<float> penetration;
+};
+
+void applyImpulse(SolverBodies& bodies, int32_t bodyA, int32_t bodyB, float impulseX, float impulseY)
+{
+    // the static slot is shared by many contacts of one color, it must not be written concurrently
+    if (bodyA != StaticBody)
+    {
+        const auto a = static_cast<std::size_t>(bodyA);
+        bodies.velocityX[a] -= bodies.invMass[a] * impulseX;
+        bodies.velocityY[a] -= bodies.invMass[a] * impulseY;
+    }
+
+    if (bodyB != StaticBody)
+    {
+        const auto b = static_cast<std::size_t>(bodyB);
+        bodies.velocityX[b] += bodies.invMass[b] * impulseX;
+        bodies.velocityY[b] += bodies.invMass[b] * impulseY;
+    }
+}
+
+void solveConstraint(SolverBodies& bodies, SolverConstraints& constraints, uint32_t index)
+{
+    const auto a = static_cast<std::size_t>(constraints.bodyA[index]);
+    const auto b = static_cast<std::size_t>(constraints.bodyB[index]);
+    const auto normalX = constraints.normalX[index];
+    const auto normalY = constraints.normalY[index];
+
+    const auto normalVelocity = (bodies.velocityX[b] - bodies.velocityX[a]) * normalX +
+                                (bodies.velocityY[b] - bodies.velocityY[a]) * normalY;
+
+    // the accumulated impulse may only push the bodies apart, a single iteration may take some of it back
+    const auto oldImpulse = constraints.impulse[index];
+    const auto lambda = constraints.normalMass[index] * (constraints.targetVelocity[index] - normalVelocity);
+    const auto impulse = std::max(oldImpulse + lambda, 0.0f);
+    constraints.impulse[index] = impulse;
+
+    const auto applied = impulse - oldImpulse;
+    applyImpulse(bodies, constraints.bodyA[index], constraints.bodyB[index], applied * normalX, applied * normalY);
 }
 
-void resolveCollision(entt::registry* registry, const Collision& collision)
+// none of the constraints in [begin, end) may share a dynamic body
+void solveIndependent(SolverBodies& bodies, SolverConstraints& constraints, uint32_t begin, uint32_t end)
 {
-    auto [bodyA, posA, velA] =
-            registry->try_get<Body, Position, LinearVelocity>(collision.pair.bodyA);
-    auto [bodyB, posB, velB] =
-            registry->try_get<Body, Position, LinearVelocity>(collision.pair.bodyB);
+    auto index = begin;
+
+#if defined(__AVX2__)
+    // same operations in the same order as solveConstraint(), so both give the same result
+    for (; index + 8 <= end; index += 8)
+    {
+        const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(constraints.bodyA.data() + index));
+        const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(constraints.bodyB.data() + index));
 
-    LinearVelocity nullVel{};
+        const auto velocityAX = _mm256_i32gather_ps(bodies.velocityX.data(), a, 4);
+        const auto velocityAY = _mm256_i32gather_ps(bodies.velocityY.data(), a, 4);
+        const auto velocityBX = _mm256_i32gather_ps(bodies.velocityX.data(), b, 4);
+        const auto velocityBY = _mm256_i32gather_ps(bodies.velocityY.data(), b, 4);
+        const auto invMassA = _mm256_i32gather_ps(bodies.invMass.data(), a, 4);
+        const auto invMassB = _mm256_i32gather_ps(bodies.invMass.data(), b, 4);
 
-    if (!velA)
-        velA = &nullVel;
-    if (!velB)
-        velB = &nullVel;
+        const auto normalX = _mm256_loadu_ps(constraints.normalX.data() + index);
+        const auto normalY = _mm256_loadu_ps(constraints.normalY.data() + index);
 
-    const auto vd = velB->value - velA->value;
+        const auto normalVelocity = _mm256_add_ps(
+                _mm256_mul_ps(_mm256_sub_ps(velocityBX, velocityAX), normalX),
+                _mm256_mul_ps(_mm256_sub_ps(velocityBY, velocityAY), normalY));
 
-    float r = glm::dot(vd, collision.direction);
-    if (r > 0.0f) // bodies are separating
-        r = -r;
+        const auto oldImpulse = _mm256_loadu_ps(constraints.impulse.data() + index);
+        const auto lambda = _mm256_mul_ps(
+                _mm256_loadu_ps(constraints.normalMass.data() + index),
+                _mm256_sub_ps(_mm256_loadu_ps(constraints.targetVelocity.data() + index), normalVelocity));
+        const auto impulse = _mm256_max_ps(_mm256_add_ps(oldImpulse, lambda), _mm256_setzero_ps());
+        _mm256_storeu_ps(constraints.impulse.data() + index, impulse);
 
-    float e = glm::max(1.0f, glm::max(bodyA->restitution, bodyB->restitution));
+        const auto applied = _mm256_sub_ps(impulse, oldImpulse);
+        const auto impulseX = _mm256_mul_ps(applied, normalX);
+        const auto impulseY = _mm256_mul_ps(applied, normalY);
 
-    float invMassSum = bodyA->invMass + bodyB->invMass;
+        // there is no scatter in AVX2, the lanes are written back one by one
+        alignas(32) float resultAX[8];
+        alignas(32) float resultAY[8];
+        alignas(32) float resultBX[8];
+        alignas(32) float resultBY[8];
+        _mm256_store_ps(resultAX, _mm256_sub_ps(velocityAX, _mm256_mul_ps(invMassA, impulseX)));
+        _mm256_store_ps(resultAY, _mm256_sub_ps(velocityAY, _mm256_mul_ps(invMassA, impulseY)));
+        _mm256_store_ps(resultBX, _mm256_add_ps(velocityBX, _mm256_mul_ps(invMassB, impulseX)));
+        _mm256_store_ps(resultBY, _mm256_add_ps(velocityBY, _mm256_mul_ps(invMassB, impulseY)));
 
-    glm::vec2 impulse = (-e * r) * collision.direction;
+        for (uint32_t lane = 0; lane < 8; lane++)
+        {
+            if (const auto bodyA = constraints.bodyA[index + lane]; bodyA != StaticBody)
+            {
+                bodies.velocityX[static_cast<std::size_t>(bodyA)] = resultAX[lane];
+                bodies.velocityY[static_cast<std::size_t>(bodyA)] = resultAY[lane];
+            }
 
-    // apply impulse (TODO use force?)
-    velA->value -= (bodyA->invMass / invMassSum) * impulse;
-    velB->value += (bodyB->invMass / invMassSum)  * impulse;
+            if (const auto bodyB = constraints.bodyB[index + lane]; bodyB != StaticBody)
+            {
+                bodies.velocityX[static_cast<std::size_t>(bodyB)] = resultBX[lane];
+                bodies.velocityY[static_cast<std::size_t>(bodyB)] = resultBY[lane];
+            }
+        }
+    }
+#endif
+
+    for (; index < end; index++)
+        solveConstraint(bodies, constraints, index);
+}
 
-    // position correction
-    constexpr float percent = 0.2f;
-    glm::vec2 correction = (collision.penetration / invMassSum) * percent * collision.direction;
-    posA->value -= bodyA->invMass * correction;
-    posB->value += bodyB->invMass * correction;
+} // namespace
 
-    registry->emplace_or_replace<TransformChangedTag>(collision.pair.bodyA);
-    registry->emplace_or_replace<TransformChangedTag>(collision.pair.bodyB);
+ContactSolver::ContactSolver(JobSystem* jobSystem) :
+    jobSystem_{jobSystem},
+    stats_{}
+{
+}
+
+void ContactSolver::solve(entt::registry* registry, ContactManager* contactManager, ChangeSet* transformChanges,
+                          std::span<const uint32_t> contacts, uint32_t iterations, bool warmStarting,
+                          MemoryArena* frameMemoryArena)
+{
+    NGN_INSTRUMENT_FUNCTION();
+
+    stats_ = {};
+
+    // gather the bodies, every body is looked up once
+
+    SolverBodies bodies{frameMemoryArena};
+    bodies.add(entt::null, nullptr, nullptr, 0.0f);
+
+    bodySlots_.clear();
+
+    auto bodySlot = [registry, &bodies, this](entt::entity entity)
+    {
+        const auto [it, inserted] = bodySlots_.try_emplace(entity, StaticBody);
+        if (!inserted)
+            return it->second;
+
+        // static bodies and bodies of infinite mass are not moved
+        auto [body, position, velocity] = registry->try_get<const Body, Position, LinearVelocity>(entity);
+        if (!velocity || body->invMass == 0.0f)
+            return StaticBody;
+
+        const auto slot = static_cast<int32_t>(bodies.entities.size());
+        it->second = slot;
+        bodies.add(entity, position, velocity, body->invMass);
+        return slot;
+    };
+
+    // gather and color the constraints
+
+    auto constraints = frameVector<Constraint>(frameMemoryArena);
+    constraints.reserve(contacts.size());
+
+    uint32_t colorCounts[MaxColors]{};
+
+    for (const auto contactIndex : contacts)
+    {
+        const auto& contact = contactManager->contact(contactIndex);
+        const auto& collision = contact.collision;
+
+        // bodies might have been destroyed by collision listeners
+        if (!registry->valid(collision.pair.bodyA) || !registry->valid(collision.pair.bodyB))
+            continue;
+
+        const auto bodyA = bodySlot(collision.pair.bodyA);
+        const auto bodyB = bodySlot(collision.pair.bodyB);
+
+        const auto a = static_cast<std::size_t>(bodyA);
+        const auto b = static_cast<std::size_t>(bodyB);
+
+        const auto invMassSum = bodies.invMass[a] + bodies.invMass[b];
+        if (invMassSum == 0.0f)
+            continue;
+
+        // Body::restitution is the part of the approaching velocity taken away, 1 stops the bodies and 1.5 bounces
+        // them off with half of it
+        const auto restitutionA = registry->get<const Body>(collision.pair.bodyA).restitution;
+        const auto restitutionB = registry->get<const Body>(collision.pair.bodyB).restitution;
+        const auto restitution = std::max(std::max(restitutionA, restitutionB) - 1.0f, 0.0f);
+
+        const auto normalVelocity = glm::dot(
+                glm::vec2{bodies.velocityX[b] - bodies.velocityX[a], bodies.velocityY[b] - bodies.velocityY[a]},
+                collision.direction);
+
+        // lowest color used by neither body, the colors of the static slot are never set
+        auto color = static_cast<uint32_t>(std::countr_one(bodies.colors[a] | bodies.colors[b]));
+        if (color >= OverflowColor)
+        {
+            color = OverflowColor;
+        }
+        else
+        {
+            if (bodyA != StaticBody)
+                bodies.colors[a] |= 1U << color;
+            if (bodyB != StaticBody)
+                bodies.colors[b] |= 1U << color;
+        }
+        colorCounts[color]++;
+
+        constraints.push_back(Constraint{
+            .contact = contactIndex,
+            .bodyA = bodyA,
+            .bodyB = bodyB,
+            .color = color,
+            .normal = collision.direction,
+            .normalMass = 1.0f / invMassSum,
+            .targetVelocity = normalVelocity < -RestitutionVelocity ? -restitution * normalVelocity : 0.0f,
+            .impulse = warmStarting ? contact.normalImpulse : 0.0f,
+            .penetration = collision.penetration,
+        });
+    }
+
+    uint32_t colorOffsets[MaxColors + 1]{};
+    for (uint32_t color = 0; color < MaxColors; color++)
+    {
+        colorOffsets[color + 1] = colorOffsets[color] + colorCounts[color];
+        if (colorCounts[color] > 0)
+            stats_.colorCount++;
+    }
+
+    SolverConstraints sorted{frameMemoryArena, constraints.size()};
+
+    uint32_t colorCursors[MaxColors];
+    std::copy_n(colorOffsets, MaxColors, colorCursors);
+
+    for (const auto& constraint : constraints)
+        sorted.set(colorCursors[constraint.color]++, constraint);
+
+    const auto constraintCount = static_cast<uint32_t>(constraints.size());
+    stats_.constraintCount = constraintCount;
+
+    // start from the impulses of the last update, contacts which keep touching need about the same
+
+    if (warmStarting)
+    {
+        for (uint32_t index = 0; index < constraintCount; index++)
+        {
+            const auto impulse = sorted.impulse[index];
+            applyImpulse(bodies, sorted.bodyA[index], sorted.bodyB[index],
+                         impulse * sorted.normalX[index], impulse * sorted.normalY[index]);
+        }
+    }
+
+    // The colors are solved one after the other. Within a color no body is shared, so the contacts of a color can be
+    // solved in any order and on any thread, only the overflow color has to be solved sequentially.
+
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        for (uint32_t color = 0; color < OverflowColor; color++)
+        {
+            const auto begin = colorOffsets[color];
+            const auto count = colorOffsets[color + 1] - begin;
+
+            jobSystem_->parallelFor(count, BatchSize, [&bodies, &sorted, begin](uint32_t first, uint32_t last, uint32_t)
+            {
+                solveIndependent(bodies, sorted, begin + first, begin + last);
+            });
+        }
+
+        for (auto index = colorOffsets[OverflowColor]; index < constraintCount; index++)
+            solveConstraint(bodies, sorted, index);
+    }
+
+    // push the bodies apart, all corrections of a body add up
+
+    for (uint32_t index = 0; index < constraintCount; index++)
+    {
+        const auto a = static_cast<std::size_t>(sorted.bodyA[index]);
+        const auto b = static_cast<std::size_t>(sorted.bodyB[index]);
+
+        const auto correction = sorted.penetration[index] * sorted.normalMass[index] * CorrectionPercent *
+                                glm::vec2{sorted.normalX[index], sorted.normalY[index]};
+        bodies.correction[a] -= bodies.invMass[a] * correction;
+        bodies.correction[b] += bodies.invMass[b] * correction;
+
+        contactManager->contact(sorted.contact[index]).normalImpulse = sorted.impulse[index];
+    }
+
+    // write back, the static slot is skipped
+
+    for (std::size_t slot = 1; slot < bodies.entities.size(); slot++)
+    {
+        bodies.velocities[slot]->value = {bodies.velocityX[slot], bodies.velocityY[slot]};
+        bodies.positions[slot]->value += bodies.correction[slot];
+        transformChanges->mark(bodies.entities[slot]);
+    }
 }
 
 } // namespace ngn
+
+NGN_INSTRUMENTATION_EPILOG(Solver)
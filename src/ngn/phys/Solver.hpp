@@ -3,11 +3,52 @@
 
 #pragma once
 
-#include "Collision.hpp"
+#include "Macros.hpp"
+#include "utils/FlatHash.hpp"
+#include <entt/fwd.hpp>
+#include <span>
 
 namespace ngn {
 
-void resolveCollisions(entt::registry* registry, const CollisionList& collisions);
-void resolveCollision(entt::registry* registry, const Collision& collision);
+class ChangeSet;
+class ContactManager;
+class JobSystem;
+class MemoryArena;
+
+class SolverStats
+{
+public:
+    uint32_t constraintCount{};
+    uint32_t colorCount{};
+};
+
+// Sequential impulse solver for the colliding contacts. The bodies and contacts are gathered into flat arrays once
+// per update and the accumulated impulse of every contact is kept in the contact manager, so the next update starts
+// from it. The contacts are colored such that no two contacts of one color share a dynamic body, the contacts of a
+// color are solved eight at once with AVX2 and in batches across the job system.
+class ContactSolver
+{
+public:
+    explicit ContactSolver(JobSystem* jobSystem);
+
+    // contacts are indices into the contact manager, every contact must be colliding, the moved bodies are marked in
+    // transformChanges
+    void solve(entt::registry* registry, ContactManager* contactManager, ChangeSet* transformChanges,
+               std::span<const uint32_t> contacts, uint32_t iterations, bool warmStarting,
+               MemoryArena* frameMemoryArena);
+
+    // statistics of the last solve() call
+    const SolverStats& stats() const { return stats_; }
+
+private:
+    JobSystem* jobSystem_;
+
+    // solver slot of the bodies, reused between updates
+    FlatHashMap<entt::entity, int32_t> bodySlots_;
+
+    SolverStats stats_;
+
+    NGN_DISABLE_COPY_MOVE(ContactSolver)
+};
 
 } // namespace ngn
@@ -0,0 +1,80 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#include "TreeBroadphase.hpp"
+
+namespace ngn {
+
+TreeBroadphase::TreeBroadphase(uint32_t optimizeBudget, uint32_t relayoutInterval) :
+    tree_{nullptr},
+    optimizeBudget_{optimizeBudget},
+    relayoutInterval_{relayoutInterval},
+    updatesSinceRelayout_{0}
+{
+}
+
+uint32_t TreeBroadphase::addObject(const AABB& aabb, entt::entity entity, const CollisionFilter& filter)
+{
+    return tree_.addObject(aabb, entity, filter);
+}
+
+bool TreeBroadphase::updateObject(uint32_t objectId, const AABB& aabb)
+{
+    return tree_.updateObject(objectId, aabb);
+}
+
+void TreeBroadphase::removeObject(uint32_t objectId)
+{
+    tree_.removeObject(objectId);
+}
+
+void TreeBroadphase::finishUpdate()
+{
+    tree_.optimize(optimizeBudget_);
+
+    if (relayoutInterval_ && ++updatesSinceRelayout_ >= relayoutInterval_)
+    {
+        tree_.relayout();
+        updatesSinceRelayout_ = 0;
+    }
+
+    // no wide nodes, the tree changes every update and its pairs and ray casts walk the binary nodes anyway
+}
+
+void TreeBroadphase::queryPairs(std::span<const uint32_t> moved, const PairCallback& callback)
+{
+    tree_.queryPairs(moved, callback);
+}
+
+void TreeBroadphase::query(const AABB& aabb, const QueryCallback& callback) const
+{
+    tree_.query(aabb, callback);
+}
+
+float TreeBroadphase::rayCast(const Line& segment, float maxFraction, const RayCastCallback& callback) const
+{
+    return tree_.rayCast(segment, maxFraction, callback);
+}
+
+void TreeBroadphase::walkBounds(const BoundsCallback& callback) const
+{
+    tree_.walkTree([&callback](const TreeNode& node)
+    {
+        callback(node.aabb, node.isLeaf());
+        return true;
+    });
+}
+
+BroadphaseStats TreeBroadphase::stats() const
+{
+    const auto treeStats = tree_.stats();
+
+    return BroadphaseStats{
+        .objectCount = treeStats.leafCount,
+        .nodeCount = treeStats.nodeCount,
+        .depth = treeStats.height,
+        .cost = treeStats.sahCost,
+    };
+}
+
+} // namespace ngn
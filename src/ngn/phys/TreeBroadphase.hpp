@@ -0,0 +1,45 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Broadphase.hpp"
+#include "DynamicTree.hpp"
+#include "Macros.hpp"
+
+namespace ngn {
+
+class TreeBroadphase final : public Broadphase
+{
+public:
+    // optimizeBudget is passed to DynamicTree::optimize() on every update, DynamicTree::relayout() is called every
+    // relayoutInterval updates
+    TreeBroadphase(uint32_t optimizeBudget, uint32_t relayoutInterval);
+
+    uint32_t addObject(const AABB& aabb, entt::entity entity, const CollisionFilter& filter) override;
+    bool updateObject(uint32_t objectId, const AABB& aabb) override;
+    void removeObject(uint32_t objectId) override;
+
+    const AABB& fatAABB(uint32_t objectId) const override { return tree_.fatAABB(objectId); }
+    entt::entity entity(uint32_t objectId) const override { return tree_.entity(objectId); }
+
+    void finishUpdate() override;
+
+    void queryPairs(std::span<const uint32_t> moved, const PairCallback& callback) override;
+    void query(const AABB& aabb, const QueryCallback& callback) const override;
+    float rayCast(const Line& segment, float maxFraction, const RayCastCallback& callback) const override;
+
+    void walkBounds(const BoundsCallback& callback) const override;
+
+    BroadphaseStats stats() const override;
+
+private:
+    DynamicTree tree_;
+    uint32_t optimizeBudget_;
+    uint32_t relayoutInterval_;
+    uint32_t updatesSinceRelayout_;
+
+    NGN_DISABLE_COPY_MOVE(TreeBroadphase)
+};
+
+} // namespace ngn
@@ -3,15 +3,18 @@
 
 #include "World.hpp"
 
-#include "Application.hpp"
 #include "CommonComponents.hpp"
+#include "GridBroadphase.hpp"
 #include "Instrumentation.hpp"
 #include "Functions.hpp"
 #include "Math.hpp"
+#include "NarrowPhase.hpp"
 #include "PhysComponents.hpp"
 #include "CollisionTests.hpp"
 #include "Solver.hpp"
+#include "TreeBroadphase.hpp"
 #include <glm/gtx/norm.hpp>
+#include <algorithm>
 
 #if defined(NGN_ENABLE_VISUAL_DEBUGGING)
 #include "gfx/DebugRenderer.hpp"
@@ -21,11 +24,49 @@ namespace ngn {
 
 namespace {
 
+// fast bodies are stopped this deep inside the body they hit, so the narrow phase reports the contact
+constexpr float TimeOfImpactSlop = 0.1f;
+
+using NarrowPhaseTestList = std::vector<NarrowPhaseTest, LinearAllocator<NarrowPhaseTest>>;
+using ContactList = std::vector<Contact, LinearAllocator<Contact>>;
+
+// Polygons of bodies are transformed into the second half of the slot holding their local vertices, see
+// World::allocatePolygonVertices().
+glm::vec2* transformedVertices(const Shape& origShape)
+{
+    if (origShape.type != Shape::Type::ConvexPolygon)
+        return nullptr;
+
+    // the slot is owned by World, only the view of the polygon is const
+    return const_cast<glm::vec2*>(origShape.polygon.vertices) + ConvexPolygon::MaxVertices;
+}
+
+// the same collision seen from the other body
+Collision turnAround(const Collision& collision)
+{
+    return {
+        .pair = {.bodyA = collision.pair.bodyB, .bodyB = collision.pair.bodyA},
+        .point = collision.point - collision.direction * collision.penetration,
+        .direction = -collision.direction,
+        .penetration = collision.penetration,
+        .colliding = collision.colliding,
+    };
+}
+
 class NodeInfo
 {
 public:
     Shape origShape;
     uint32_t nodeId;
+    // frame in which the shape was updated last
+    uint32_t movedFrame;
+};
+
+// bodies created with dynamic = false, their shape is transformed once
+class StaticNodeInfo
+{
+public:
+    uint32_t nodeId;
 };
 
 class LastPosition
@@ -34,24 +75,255 @@ public:
     glm::vec2 value;
 };
 
+// dynamic bodies only
+class SleepInfo
+{
+public:
+    // time the body has been resting
+    float time;
+    // node in the island pass of islandFrame
+    uint32_t islandNode;
+    uint32_t islandFrame;
+};
+
+// Dynamic bodies which are awake. The group owns the components read and written by the integration, which keeps
+// them packed in the same order at the front of their pools, so it walks plain arrays without sparse set lookups.
+auto integrationGroup(entt::registry* registry)
+{
+    return registry->group<
+            Position,
+            LastPosition,
+            Rotation,
+            LinearVelocity,
+            AngularVelocity,
+            LinearForce,
+            AngularForce,
+            Body>(entt::get<ActiveTag>, entt::exclude<SleepingTag>);
+}
+
+// The pools store their packed components in pages of this size, see componentPage().
+constexpr std::size_t IntegrationPageSize = entt::component_traits<Position>::page_size;
+
+// bits of the transform changes found by integrateTransforms()
+constexpr uint8_t PositionChanged = 1;
+constexpr uint8_t RotationChanged = 2;
+
+// the page of the packed components of the pool containing the given index
+template<typename Component>
+Component* componentPage(entt::registry* registry, std::size_t index)
+{
+    static_assert(entt::component_traits<Component>::page_size == IntegrationPageSize);
+    return registry->storage<Component>().raw()[index / IntegrationPageSize];
+}
+
+// Up to IntegrationPageSize bodies of the integration group, the components of one body are at the same index in all
+// arrays.
+class IntegrationPage
+{
+public:
+    std::size_t size;
+    Position* positions;
+    LastPosition* lastPositions;
+    Rotation* rotations;
+    LinearVelocity* linVelocities;
+    AngularVelocity* angVelocities;
+    LinearForce* linForces;
+    AngularForce* angForces;
+    const Body* bodies;
+};
+
+// The integration loops below select values instead of branching and access single floats, so the compiler
+// vectorises them. The page is taken by value, so the compiler knows the loops do not change it.
+
+void integrateVelocities(IntegrationPage page, const WorldConfig& config, float deltaTime)
+{
+    const auto gravity = config.gravity;
+    const auto linearDamping = config.linearDamping;
+    const auto angularDamping = config.angularDamping;
+
+    // copied apart, the mixed layout of the bodies keeps the loops below from being vectorised
+    float frictions[IntegrationPageSize];
+    // 0 for bodies keeping their velocity and forces
+    float forceScales[IntegrationPageSize];
+    for (std::size_t i = 0; i < page.size; i++)
+    {
+        frictions[i] = page.bodies[i].friction;
+        forceScales[i] = page.bodies[i].useForce ? 1.0f : 0.0f;
+    }
+
+    for (std::size_t i = 0; i < page.size; i++)
+    {
+        auto& velocity = page.linVelocities[i].value;
+        auto& force = page.linForces[i].value;
+
+        // add world forces
+        const auto forceX = force.x + gravity.x;
+        const auto forceY = force.y + gravity.y;
+
+        // fast bodies are slowed down, slow bodies without a force stop
+        const auto velocityLen2 = velocity.x * velocity.x + velocity.y * velocity.y;
+        const auto damped = velocityLen2 > 100.f;
+        const auto stopped = !damped && nearZero(glm::vec2{forceX, forceY});
+        const auto resistance = damped ? 0.25f * glm::sqrt(velocityLen2) * linearDamping * frictions[i] : 0.0f;
+        const auto x = (stopped ? 0.0f : velocity.x) + (forceX - velocity.x * resistance) * deltaTime;
+        const auto y = (stopped ? 0.0f : velocity.y) + (forceY - velocity.y * resistance) * deltaTime;
+
+        velocity.x = x * forceScales[i] + velocity.x * (1.0f - forceScales[i]);
+        velocity.y = y * forceScales[i] + velocity.y * (1.0f - forceScales[i]);
+        force.x *= 1.0f - forceScales[i];
+        force.y *= 1.0f - forceScales[i];
+    }
+
+    for (std::size_t i = 0; i < page.size; i++)
+    {
+        auto& velocity = page.angVelocities[i].value;
+        auto& force = page.angForces[i].value;
+
+        const auto velocityLen2 = velocity * velocity;
+        const auto damped = velocityLen2 > 2.f;
+        const auto stopped = !damped && nearZero(force);
+        const auto resistance = damped ? 5.0f * velocityLen2 * angularDamping * frictions[i] : 0.0f;
+        const auto value = (stopped ? 0.0f : velocity) + (force - std::copysign(resistance, velocity)) * deltaTime;
+
+        velocity = value * forceScales[i] + velocity * (1.0f - forceScales[i]);
+        force *= 1.0f - forceScales[i];
+    }
+}
+
+void integrateTransforms(IntegrationPage page, float deltaTime, uint8_t* changes)
+{
+    for (std::size_t i = 0; i < page.size; i++)
+    {
+        auto& position = page.positions[i].value;
+        auto& lastPosition = page.lastPositions[i].value;
+        const auto& velocity = page.linVelocities[i].value;
+
+        const auto x = position.x + velocity.x * deltaTime;
+        const auto y = position.y + velocity.y * deltaTime;
+        changes[i] = x != position.x || y != position.y ? PositionChanged : 0;
+
+        // only read for bodies which moved
+        lastPosition.x = position.x;
+        lastPosition.y = position.y;
+        position.x = x;
+        position.y = y;
+    }
+
+    for (std::size_t i = 0; i < page.size; i++)
+    {
+        auto& angle = page.rotations[i].angle;
+
+        const auto value = angle + page.angVelocities[i].value * deltaTime;
+        changes[i] |= value != angle ? RotationChanged : 0;
+
+        angle = value;
+    }
+}
+
+class IslandNode
+{
+public:
+    entt::entity entity;
+    uint32_t parent;
+    bool sleeping;
+    // awake and not resting long enough, keeps the whole island awake
+    bool restless;
+};
+
+Broadphase* createBroadphase(const WorldConfig& config)
+{
+    switch (config.broadphase)
+    {
+        using enum BroadphaseType;
+
+        case Tree:
+            return new TreeBroadphase{config.treeOptimizeBudget, config.treeRelayoutInterval};
+
+        case Grid:
+            return new GridBroadphase{config.gridCellSize};
+    }
+
+    return nullptr;
+}
+
 } // namespace
 
-World::World(Application* app) :
-    app_{app},
-    registry_{app->registry()},
-    dynamicTree_{new DynamicTree{registry_}},
-    config_{}
+World::World(entt::registry* registry, MemoryArena* frameMemoryArena, JobSystem* jobSystem) :
+    registry_{registry},
+    frameMemoryArena_{frameMemoryArena},
+    jobSystem_{jobSystem},
+    broadphase_{createBroadphase(WorldConfig{})},
+    staticTree_{new DynamicTree{registry_}},
+    contactManager_{new ContactManager{}},
+    narrowPhase_{new NarrowPhase{jobSystem}},
+    solver_{new ContactSolver{jobSystem}},
+    config_{},
+    stats_{},
+    frame_{},
+    staticDirty_{},
+    nextBatchListenerId_{},
+    deliveringBatches_{}
 {
+    registry_->on_construct<ActiveTag>().connect<&World::onStaticBodyAdded>(this);
+    registry_->on_destroy<ActiveTag>().connect<&World::onStaticBodyRemoved>(this);
+    registry_->on_destroy<StaticNodeInfo>().connect<&World::onStaticBodyRemoved>(this);
+    registry_->on_construct<ActiveTag>().connect<&World::onDynamicBodyToggled>(this);
+    registry_->on_destroy<ActiveTag>().connect<&World::onDynamicBodyToggled>(this);
+    registry_->on_destroy<NodeInfo>().connect<&World::onDynamicBodyRemoved>(this);
+    registry_->on_destroy<Shape>().connect<&World::onShapeRemoved>(this);
+
+    // created before the first body, so its components are packed from the start
+    integrationGroup(registry_);
 }
 
 World::~World()
 {
-    delete dynamicTree_;
+    registry_->on_construct<ActiveTag>().disconnect<&World::onStaticBodyAdded>(this);
+    registry_->on_destroy<ActiveTag>().disconnect<&World::onStaticBodyRemoved>(this);
+    registry_->on_destroy<StaticNodeInfo>().disconnect<&World::onStaticBodyRemoved>(this);
+    registry_->on_construct<ActiveTag>().disconnect<&World::onDynamicBodyToggled>(this);
+    registry_->on_destroy<ActiveTag>().disconnect<&World::onDynamicBodyToggled>(this);
+    registry_->on_destroy<NodeInfo>().disconnect<&World::onDynamicBodyRemoved>(this);
+    registry_->on_destroy<Shape>().disconnect<&World::onShapeRemoved>(this);
+
+    delete solver_;
+    delete narrowPhase_;
+    delete contactManager_;
+    delete staticTree_;
+    delete broadphase_;
 }
 
 void World::setConfig(WorldConfig config)
 {
+    const auto recreate = config.broadphase != config_.broadphase ||
+                          config.treeOptimizeBudget != config_.treeOptimizeBudget ||
+                          config.treeRelayoutInterval != config_.treeRelayoutInterval ||
+                          config.gridCellSize != config_.gridCellSize;
+
     config_ = std::move(config);
+
+    if (!config_.allowSleep)
+    {
+        registry_->clear<SleepingTag>();
+        for (auto [e, sleepInfo] : registry_->view<SleepInfo>().each())
+            sleepInfo.time = 0.0f;
+    }
+
+    if (!recreate)
+        return;
+
+    delete broadphase_;
+    broadphase_ = createBroadphase(config_);
+
+    // existing contacts stay valid, they are looked up by the new node ids
+    auto view = registry_->view<const Shape, const Body, NodeInfo>();
+    for (auto [e, shape, body, nodeInfo] : view.each())
+    {
+        if (nodeInfo.nodeId != InvalidIndex)
+            nodeInfo.nodeId = broadphase_->addObject(calculateAABB(shape), e, body.filter);
+    }
+
+    broadphase_->finishUpdate();
 }
 
 void World::createBody(entt::entity entity, const BodyCreateInfo& createInfo, Shape shape)
@@ -60,20 +332,18 @@ void World::createBody(entt::entity entity, const BodyCreateInfo& createInfo, Sh
     {
         assert(!createInfo.fastMoving || shape.type == Shape::Type::Circle);
 
-        if (createInfo.useForce)
-        {
-            registry_->emplace<LinearForce>(entity);
-            registry_->emplace<AngularForce>(entity);
-        }
+        // forces are emplaced regardless of useForce to keep all dynamic bodies in the integration group
+        registry_->emplace<LinearForce>(entity);
+        registry_->emplace<AngularForce>(entity);
         registry_->emplace<LinearVelocity>(entity);
         registry_->emplace<AngularVelocity>(entity);
+        registry_->emplace<SleepInfo>(entity, 0.0f, InvalidIndex, 0U);
     }
 
     if (const auto* pos = registry_->try_get<Position>(entity); !pos)
         registry_->emplace<Position>(entity, glm::vec2{});
 
     registry_->emplace<LastPosition>(entity);
-    registry_->emplace<TransformChangedTag>(entity);
 
     registry_->emplace<Body>(entity, Body{
         .invMass = createInfo.invMass,
@@ -81,278 +351,856 @@ void World::createBody(entt::entity entity, const BodyCreateInfo& createInfo, Sh
         .restitution = createInfo.restitution,
         .sensor = createInfo.sensor,
         .fastMoving = createInfo.fastMoving,
+        .useForce = createInfo.useForce,
+        .filter = createInfo.filter,
     });
 
+    if (shape.type == Shape::Type::ConvexPolygon)
+        shape.polygon.vertices = allocatePolygonVertices(shape.polygon);
+
     const auto transformedShape = transformShape(entity, shape);
     registry_->emplace<Shape>(entity, transformedShape);
 
+    if (!createInfo.dynamic)
+    {
+        // added to the static tree by the next update
+        registry_->emplace<StaticNodeInfo>(entity, InvalidIndex);
+        staticDirty_ = true;
+        return;
+    }
+
+    transformChanges_.mark(entity);
+
     auto nodeId = InvalidIndex;
     if (registry_->any_of<ActiveTag>(entity))
-        nodeId = dynamicTree_->addObject(calculateAABB(transformedShape), entity);
-    registry_->emplace<NodeInfo>(entity, shape, nodeId);
+        nodeId = broadphase_->addObject(calculateAABB(transformedShape), entity, createInfo.filter);
+    registry_->emplace<NodeInfo>(entity, shape, nodeId, frame_);
 }
 
 void World::update(float deltaTime)
 {
+    using instrumentation::cpuTimer;
+
+    frame_++;
+
+    auto t0 = cpuTimer();
     updateActive();
-    integrate(deltaTime);
+    updateStatic();
+    wakeChangedBodies();
+    auto t1 = cpuTimer();
+    stats_.updateActiveTime = t1 - t0;
+
+    t0 = t1;
+    const auto fastBodies = integrate(deltaTime);
+    t1 = cpuTimer();
+    stats_.integrateTime = t1 - t0;
+
+    t0 = t1;
     const auto moved = updateTree();
-    const auto possibleCollisions = findPossibleCollisions(moved);
-    const auto collisions = findActualCollsions(possibleCollisions);
-    resolveCollisions(registry_, collisions);
+    t1 = cpuTimer();
+    stats_.updateTreeTime = t1 - t0;
+
+    // swept against the shapes moved by updateTree(), counted as part of the integration
+    t0 = t1;
+    advanceFastBodies(fastBodies);
+    t1 = cpuTimer();
+    stats_.integrateTime += t1 - t0;
+
+    t0 = t1;
+    findPossibleCollisions(moved);
+    t1 = cpuTimer();
+    stats_.findPossibleCollisionsTime = t1 - t0;
+
+    t0 = t1;
+    const auto collisions = findActualCollsions();
+    t1 = cpuTimer();
+    stats_.findActualCollisionsTime = t1 - t0;
+
+    t0 = t1;
+    solver_->solve(registry_, contactManager_, &transformChanges_, collisions, config_.solverIterations,
+                   config_.warmStarting, frameMemoryArena_);
+    t1 = cpuTimer();
+    stats_.resolveCollisionsTime = t1 - t0;
+
+    t0 = t1;
+    updateSleep(deltaTime);
+    t1 = cpuTimer();
+    stats_.updateSleepTime = t1 - t0;
+
+    deliverCollisionBatches();
+
+    stats_.movedCount = static_cast<uint32_t>(moved.size());
+    stats_.possibleCollisionCount = contactManager_->size();
+    stats_.collisionCount = solver_->stats().constraintCount;
+    stats_.solverColorCount = solver_->stats().colorCount;
+
+#if defined(NGN_ENABLE_INSTRUMENTATION)
+    // not part of the stage times above, so it does not skew them
+    const auto broadphaseStats = broadphase_->stats();
+    NGN_INSTRUMENT_VALUE("broadphase.depth", broadphaseStats.depth);
+    NGN_INSTRUMENT_VALUE("broadphase.nodeCount", broadphaseStats.nodeCount);
+    NGN_INSTRUMENT_VALUE("broadphase.cost", broadphaseStats.cost);
+#endif
+}
+
+BroadphaseStats World::broadphaseStats() const
+{
+    return broadphase_->stats();
+}
+
+uint32_t World::addCollisionBatchListener(CollisionBatchCallback callback, const entt::sparse_set* tagA,
+                                          const entt::sparse_set* tagB, ContactEvent event)
+{
+    const auto id = nextBatchListenerId_++;
+    batchListeners_.push_back({
+        .callback = callback,
+        .tagA = tagA,
+        .tagB = tagB,
+        .event = event,
+        .id = id,
+        .removed = false,
+    });
+    return id;
+}
+
+void World::removeCollisionBatchListener(uint32_t id)
+{
+    // listeners may remove themselves or others while being called, so erasing waits until the delivery is done
+    if (deliveringBatches_)
+    {
+        for (auto& listener : batchListeners_)
+        {
+            if (listener.id == id)
+                listener.removed = true;
+        }
+        return;
+    }
+
+    std::erase_if(batchListeners_, [id](const CollisionBatchListener& listener) { return listener.id == id; });
+}
+
+void World::deliverCollisionBatches()
+{
+    NGN_INSTRUMENT_FUNCTION();
+
+    auto has = [](const entt::sparse_set* tag, entt::entity entity) { return !tag || tag->contains(entity); };
+
+    deliveringBatches_ = true;
+
+    // by index, listeners added by a callback may reallocate the vector, they are first called by the next update
+    const auto listenerCount = batchListeners_.size();
+    for (std::size_t index = 0; index < listenerCount; index++)
+    {
+        if (batchListeners_[index].removed)
+            continue;
+
+        const auto tagA = batchListeners_[index].tagA;
+        const auto tagB = batchListeners_[index].tagB;
+        const auto event = batchListeners_[index].event;
+
+        collisionBatch_.clear();
+
+        for (const auto& record : collisionEvents_)
+        {
+            const auto& collision = record.collision;
+            const auto bodyA = collision.pair.bodyA;
+            const auto bodyB = collision.pair.bodyB;
+
+            if (record.event != event)
+                continue;
+
+            // End is kept for destroyed bodies, they only match AnyBody as their tags are gone
+            if (event != ContactEvent::End && (!registry_->valid(bodyA) || !registry_->valid(bodyB)))
+                continue;
+
+            if (has(tagA, bodyA) && has(tagB, bodyB))
+                collisionBatch_.push_back(collision);
+            else if (has(tagA, bodyB) && has(tagB, bodyA))
+                collisionBatch_.push_back(turnAround(collision));
+        }
+
+        if (!collisionBatch_.empty())
+        {
+            // copied, the callback may add listeners
+            const auto callback = batchListeners_[index].callback;
+            callback(collisionBatch_);
+        }
+    }
+
+    deliveringBatches_ = false;
+    std::erase_if(batchListeners_, [](const CollisionBatchListener& listener) { return listener.removed; });
+
+    collisionEvents_.clear();
 }
 
 Shape World::transformShape(entt::entity entity, const Shape& origShape)
 {
-    auto [pos, rot, sca]= registry_->try_get<const Position, const Rotation, const Scale>(entity);
+    // bodies always have a position, see createBody()
+    const auto& pos = registry_->get<const Position>(entity);
+    auto [rot, sca] = registry_->try_get<const Rotation, const Scale>(entity);
     if (sca)
-        return transform(origShape, *pos, *rot, *sca);
-    else if (pos)
-        return transform(origShape, *pos);
-    return origShape;
+        return transform(origShape, pos, *rot, *sca, transformedVertices(origShape));
+    return transform(origShape, pos, transformedVertices(origShape));
+}
+
+const glm::vec2* World::allocatePolygonVertices(const ConvexPolygon& polygon)
+{
+    assert(polygon.count >= 3 && polygon.count <= ConvexPolygon::MaxVertices);
+
+    glm::vec2* vertices{};
+    if (!freePolygonVertices_.empty())
+    {
+        vertices = freePolygonVertices_.back();
+        freePolygonVertices_.pop_back();
+    }
+    else
+    {
+        vertices = polygonVertices_.emplace_back().data();
+    }
+
+    std::copy_n(polygon.vertices, polygon.count, vertices);
+    return vertices;
+}
+
+void World::onShapeRemoved(entt::registry& registry, entt::entity entity)
+{
+    // the Shape component points to the transformed half of the slot
+    const auto& shape = registry.get<const Shape>(entity);
+    if (shape.type == Shape::Type::ConvexPolygon)
+        freePolygonVertices_.push_back(const_cast<glm::vec2*>(shape.polygon.vertices) - ConvexPolygon::MaxVertices);
 }
 
 void World::updateActive()
 {
-    auto view = registry_->view<NodeInfo>();
-    for (auto [e, nodeInfo] : view.each())
+    // the current state is compared, so bodies toggled more than once or listed twice are handled only once
+    for (const auto e : activeChanged_)
     {
+        if (!registry_->valid(e))
+            continue;
+
+        auto* nodeInfo = registry_->try_get<NodeInfo>(e);
+        if (!nodeInfo)
+            continue;
+
         const auto active = registry_->any_of<ActiveTag>(e);
 
-        if (active && nodeInfo.nodeId == InvalidIndex)
+        if (active && nodeInfo->nodeId == InvalidIndex)
         {
-            auto shape = registry_->get<Shape>(e);
-            shape = transformShape(e, nodeInfo.origShape);
+            const auto shape = transformShape(e, nodeInfo->origShape);
+
+            nodeInfo->nodeId = broadphase_->addObject(calculateAABB(shape), e, registry_->get<const Body>(e).filter);
 
-            nodeInfo.nodeId = dynamicTree_->addObject(calculateAABB(shape), e);
+            // looked for new pairs even when it does not move
+            transformChanges_.mark(e);
         }
-        else if (!active && nodeInfo.nodeId != InvalidIndex)
+        else if (!active && nodeInfo->nodeId != InvalidIndex)
         {
-            dynamicTree_->removeObject(nodeInfo.nodeId);
+            broadphase_->removeObject(nodeInfo->nodeId);
 
-            nodeInfo.nodeId = InvalidIndex;
+            nodeInfo->nodeId = InvalidIndex;
 
-#if defined(NGN_ENABLE_VISUAL_DEBUGGING)
-            removeDebugState(e);
-#endif
+            // starts awake when it is activated again
+            registry_->remove<SleepingTag>(e);
+            registry_->get<SleepInfo>(e).time = 0.0f;
         }
     }
+
+    activeChanged_.clear();
 }
 
-void World::integrate(float deltaTime)
+void World::updateStatic()
+{
+    if (!staticDirty_)
+        return;
+
+    staticDirty_ = false;
+
+    std::vector<TreeBuildItem, LinearAllocator<TreeBuildItem>> items{createFrameAllocator<TreeBuildItem>()};
+
+    auto view = registry_->view<const Shape, const Body, StaticNodeInfo>();
+    for (auto [e, shape, body, nodeInfo] : view.each())
+    {
+        nodeInfo.nodeId = InvalidIndex;
+        if (registry_->any_of<ActiveTag>(e))
+            items.push_back(TreeBuildItem{.aabb = calculateAABB(shape), .entity = e, .filter = body.filter});
+    }
+
+    IndexList nodeIds(items.size(), createFrameAllocator<uint32_t>());
+
+    staticTree_->build(items, nodeIds, jobSystem_);
+    staticTree_->rebuildWideNodes();
+
+    stats_.staticTree = staticTree_->stats();
+    NGN_INSTRUMENT_VALUE("staticTree.sahCost", stats_.staticTree.sahCost);
+
+    for (std::size_t i = 0; i < items.size(); ++i)
+        registry_->get<StaticNodeInfo>(items[i].entity).nodeId = nodeIds[i];
+}
+
+void World::onStaticBodyAdded(entt::registry& registry, entt::entity entity)
+{
+    if (registry.any_of<StaticNodeInfo>(entity))
+        staticDirty_ = true;
+}
+
+void World::onStaticBodyRemoved(entt::registry& registry, entt::entity entity)
+{
+    auto* nodeInfo = registry.try_get<StaticNodeInfo>(entity);
+    if (!nodeInfo)
+        return;
+
+    // remove it right away, queries must not report it until the tree is rebuilt
+    if (nodeInfo->nodeId != InvalidIndex)
+    {
+        staticTree_->removeObject(nodeInfo->nodeId);
+        nodeInfo->nodeId = InvalidIndex;
+    }
+
+    staticDirty_ = true;
+}
+
+void World::onDynamicBodyToggled(entt::registry& registry, entt::entity entity)
+{
+    // bodies created while active are added to the broadphase by createBody()
+    if (registry.any_of<NodeInfo>(entity))
+        activeChanged_.push_back(entity);
+}
+
+void World::onDynamicBodyRemoved(entt::registry& registry, entt::entity entity)
+{
+    // remove it right away, queries must not report it anymore
+    const auto& nodeInfo = registry.get<const NodeInfo>(entity);
+    if (nodeInfo.nodeId != InvalidIndex)
+        broadphase_->removeObject(nodeInfo.nodeId);
+}
+
+void World::wakeBody(entt::entity entity)
+{
+    if (registry_->all_of<SleepingTag>(entity))
+    {
+        registry_->remove<SleepingTag>(entity);
+        registry_->get<SleepInfo>(entity).time = 0.0f;
+    }
+}
+
+void World::wakeChangedBodies()
+{
+    // only the bodies themselves are woken, their islands follow in updateSleep()
+
+    EntityList woken{createFrameAllocator<entt::entity>()};
+
+    for (const auto e : transformChanges_.entities())
+    {
+        if (registry_->valid(e) && registry_->all_of<SleepingTag>(e))
+            woken.push_back(e);
+    }
+
+    for (auto [e, force] : registry_->view<SleepingTag, const LinearForce>().each())
+    {
+        if (!nearZero(force.value))
+            woken.push_back(e);
+    }
+
+    for (auto [e, force] : registry_->view<SleepingTag, const AngularForce>().each())
+    {
+        if (!nearZero(force.value))
+            woken.push_back(e);
+    }
+
+    for (const auto e : woken)
+        wakeBody(e);
+}
+
+EntityList World::integrate(float deltaTime)
 {
     NGN_INSTRUMENT_FUNCTION();
 
-    auto linForces = registry_->view<
-            LinearVelocity,
-            Position,
-            LastPosition,
-            AngularVelocity,
-            Rotation,
-            const Body,
-            ActiveTag>();
-    for (auto [e, linVelocity, position, lastPosition, angVelocity, rotation, body] : linForces.each())
+    // the group keeps its bodies at the front of the pools of its owned components
+    const auto count = integrationGroup(registry_).size();
+    const auto* entities = registry_->storage<Position>().data();
+
+    EntityList fastBodies{createFrameAllocator<entt::entity>()};
+
+    uint8_t changes[IntegrationPageSize];
+
+    for (std::size_t begin = 0; begin < count; begin += IntegrationPageSize)
     {
-        auto* linForce = registry_->try_get<LinearForce>(e);
-        if (linForce)
+        const IntegrationPage page{
+            .size = std::min(count - begin, IntegrationPageSize),
+            .positions = componentPage<Position>(registry_, begin),
+            .lastPositions = componentPage<LastPosition>(registry_, begin),
+            .rotations = componentPage<Rotation>(registry_, begin),
+            .linVelocities = componentPage<LinearVelocity>(registry_, begin),
+            .angVelocities = componentPage<AngularVelocity>(registry_, begin),
+            .linForces = componentPage<LinearForce>(registry_, begin),
+            .angForces = componentPage<AngularForce>(registry_, begin),
+            .bodies = componentPage<Body>(registry_, begin),
+        };
+
+        integrateVelocities(page, config_, deltaTime);
+        integrateTransforms(page, deltaTime, changes);
+
+        for (std::size_t i = 0; i < page.size; i++)
         {
-            // add world forces
-            linForce->value += config_.gravity;
+            if (!changes[i])
+                continue;
 
-            // integrate linear velocity
-            const auto linVelocityLen2 = glm::length2(linVelocity.value);
-            if (linVelocityLen2 > 100.f)
-            {
-                const auto linVelocityLen = glm::sqrt(linVelocityLen2);
-                const auto resistance = 0.5f * linVelocityLen2 * config_.linearDamping * body.friction * 0.5f;
-                linForce->value += -linVelocity.value / linVelocityLen * resistance;
-            }
-            else if (nearZero(linForce->value))
-            {
-                linVelocity.value = {};
-            }
+            const auto e = entities[begin + i];
+
+            if (changes[i] & RotationChanged)
+                page.rotations[i].update();
 
-            linVelocity.value += linForce->value * deltaTime;
+            if ((changes[i] & PositionChanged) && page.bodies[i].fastMoving)
+                fastBodies.push_back(e);
 
-            linForce->value = {};
+            transformChanges_.mark(e);
         }
+    }
 
-        // integrate position
-        const auto newPosition = position.value + linVelocity.value * deltaTime;
-        if (newPosition != position.value)
-        {
-            lastPosition.value = position.value;
-            position.value = newPosition;
+    return fastBodies;
+}
 
-            registry_->emplace_or_replace<TransformChangedTag>(e);
-        }
+void World::advanceFastBodies(const EntityList& fastBodies)
+{
+    NGN_INSTRUMENT_FUNCTION();
 
+    // Fast bodies could pass through thin bodies within one step. Their circle is swept from the last position to the
+    // integrated one and stopped at the first body it hits. The other bodies are taken at their integrated positions,
+    // as updateTree() already moved their shapes and broadphase bounds, other fast bodies at their unswept ones. The
+    // rest of the step is not simulated, so the contact goes through the narrow phase and the solver as usual.
 
-        auto* angForce = registry_->try_get<AngularForce>(e);
-        if (angForce)
-        {
-            // integrate angular velocity
-            const auto angVelocityLen2 = angVelocity.value * angVelocity.value;
-            if (angVelocityLen2 > 2.f)
-            {
-                const auto resistance = 0.5f * angVelocityLen2 * config_.angularDamping * body.friction * 10.0f;
-                angForce->value += -glm::sign(angVelocity.value) * resistance;
-            }
-            else if (nearZero(angForce->value))
-            {
-                angVelocity.value = {};
-            }
+    uint32_t hitCount{};
+
+    for (const auto e : fastBodies)
+    {
+        auto [position, lastPosition, rotation, scale, shape, nodeInfo] =
+                registry_->get<Position, const LastPosition, const Rotation, const Scale, Shape, const NodeInfo>(e);
 
-            angVelocity.value += angForce->value * deltaTime;
+        const auto translation = position.value - lastPosition.value;
+        // at the integrated position, see updateTree()
+        const auto circle = shape.circle;
 
-            angForce->value = 0.f;
-        }
+        // thin bodies can only be skipped by moving further than the radius
+        if (glm::length2(translation) <= circle.radius * circle.radius)
+            continue;
+
+        const Line path{
+            .start = circle.center - translation,
+            .end = circle.center,
+        };
+
+        const AABB sweptAabb{
+            .topLeft = glm::min(path.start, path.end) - circle.radius,
+            .bottomRight = glm::max(path.start, path.end) + circle.radius,
+        };
+
+        RayHit firstHit;
+        firstHit.fraction = 1.0f;
+        bool found = false;
 
-        // integrate rotation
-        const auto newRotation = rotation.angle + angVelocity.value * deltaTime;
-        if (newRotation != rotation.angle)
+        const auto& filter = registry_->get<const Body>(e).filter;
+
+        auto sweep = [this, e, &filter, &circle, &path, &translation, &firstHit, &found](
+                entt::entity other, const AABB&)
         {
-            rotation.angle = newRotation;
-            rotation.update();
+            const auto& otherBody = registry_->get<const Body>(other);
+            if (other == e || otherBody.sensor || !filter.collides(otherBody.filter))
+                return true;
 
-            registry_->emplace_or_replace<TransformChangedTag>(e);
-        }
+            RayHit hit;
+            if (!testCircleCast(hit, circle.radius, path, firstHit.fraction, registry_->get<const Shape>(other)))
+                return true;
+
+            // overlapping at the start and moving out of it
+            if (hit.fraction == 0.0f && glm::dot(hit.normal, translation) >= 0.0f)
+                return true;
+
+            hit.entity = other;
+            firstHit = hit;
+            found = true;
+            return true;
+        };
+
+        staticTree_->query(sweptAabb, filter, sweep);
+        broadphase_->query(sweptAabb, sweep);
+
+        if (!found)
+            continue;
+
+        position.value = lastPosition.value + translation * firstHit.fraction - firstHit.normal * TimeOfImpactSlop;
+        hitCount++;
+
+        // it was moved to the integrated position by updateTree() already, its node is still marked as moved
+        shape = transform(nodeInfo.origShape, position, rotation, scale, transformedVertices(nodeInfo.origShape));
+        if (nodeInfo.nodeId != InvalidIndex)
+            broadphase_->updateObject(nodeInfo.nodeId, calculateAABB(shape));
     }
+
+    stats_.timeOfImpactCount = hitCount;
 }
 
 MovedList World::updateTree()
 {
-    MovedList moved{app_->createFrameAllocator<uint32_t>()};
+    MovedList moved{createFrameAllocator<uint32_t>()};
 
     auto view = registry_->view<
             const Position,
             const Rotation,
             const Scale,
-            const Body,
             Shape,
             NodeInfo,
-            ActiveTag,
-            TransformChangedTag>();
-    for (auto [e, pos, rot, sca, body, shape, nodeInfo] : view.each())
+            ActiveTag>(entt::exclude<SleepingTag>);
+
+    // marks of inactive, static or destroyed entities are dropped, sleeping ones were woken by wakeChangedBodies()
+    for (const auto e : transformChanges_.entities())
     {
-        if (body.fastMoving)
-        {
-            const auto& vel = registry_->get<LinearVelocity>(e);
-            const auto tCircle = transform(shape, pos, rot, sca).circle;
-            shape = Shape{Capsule{
-                .start = tCircle.center,
-                .end = tCircle.center + vel.value,
-                .radius = tCircle.radius,
-            }};
-        }
-        else
-        {
-            shape = transform(nodeInfo.origShape, pos, rot, sca);
-        }
+        if (!view.contains(e))
+            continue;
+
+        auto [pos, rot, sca, shape, nodeInfo] =
+                view.get<const Position, const Rotation, const Scale, Shape, NodeInfo>(e);
+
+        shape = transform(nodeInfo.origShape, pos, rot, sca, transformedVertices(nodeInfo.origShape));
 
-        dynamicTree_->updateObject(nodeInfo.nodeId, calculateAABB(shape));
+        broadphase_->updateObject(nodeInfo.nodeId, calculateAABB(shape));
+        nodeInfo.movedFrame = frame_;
 
         // only dynamic bodies can move
         if (registry_->all_of<LinearVelocity>(e))
             moved.push_back(nodeInfo.nodeId);
-
-        registry_->remove<TransformChangedTag>(e);
     }
 
+    transformChanges_.clear();
+
+    broadphase_->finishUpdate();
+
     return moved;
 }
 
-CollisionPairSet World::findPossibleCollisions(const MovedList& moved)
+void World::findPossibleCollisions(const MovedList& moved)
 {
     NGN_INSTRUMENT_FUNCTION();
 
-    CollisionPairSet collisionPairs{app_->createFrameAllocator<CollisionPair>()};
-    collisionPairs.reserve(moved.size());
+    // only new pairs need to be recorded, existing contacts are kept until their fat AABBs separate
 
-    for (const auto index : moved)
+    auto callback = [this](entt::entity lhs, entt::entity rhs)
     {
-        const auto& node = dynamicTree_->node(index);
+        const CollisionPair pair = {
+            .bodyA = lhs,
+            .bodyB = rhs,
+        };
 
-#if defined(NGN_ENABLE_VISUAL_DEBUGGING)
-        removeDebugState(node.entity);
-#endif
+        const auto& bodyA = registry_->get<const Body>(pair.bodyA);
+        const auto& bodyB = registry_->get<const Body>(pair.bodyB);
 
-#if defined(NGN_ENABLE_VISUAL_DEBUGGING)
-        auto callback = [&collisionPairs, &node, this](entt::entity entity, const AABB& aabb)
-#else
-        auto callback = [&collisionPairs, &node](entt::entity entity, const AABB& aabb)
-#endif
+        contactManager_->addContact(pair, bodyA.sensor || bodyB.sensor);
+        return true;
+    };
+
+    broadphase_->queryPairs(moved, callback);
+
+    // the static tree does not change while the level is running, only moved bodies need to be tested against it
+
+    for (const auto nodeId : moved)
+    {
+        const auto movedEntity = broadphase_->entity(nodeId);
+        const auto& filter = registry_->get<const Body>(movedEntity).filter;
+        staticTree_->query(broadphase_->fatAABB(nodeId), filter, [this, movedEntity](entt::entity entity, const AABB&)
         {
-            NGN_UNUSED(aabb);
+            const CollisionPair pair = {
+                .bodyA = movedEntity,
+                .bodyB = entity,
+            };
 
-            if (entity != node.entity)
-            {
-                CollisionPair pair = {
-                    .bodyA = node.entity,
-                    .bodyB = entity,
-                };
+            const auto& bodyA = registry_->get<const Body>(pair.bodyA);
+            const auto& bodyB = registry_->get<const Body>(pair.bodyB);
 
-#if defined(NGN_ENABLE_VISUAL_DEBUGGING)
-                debugPossibleCollisions_.insert(std::make_pair(pair, AABBPair{node.aabb, aabb}));
-#endif
+            contactManager_->addContact(pair, bodyA.sensor || bodyB.sensor);
+            return true;
+        });
+    }
+}
+
+IndexList World::findActualCollsions()
+{
+    NGN_INSTRUMENT_FUNCTION();
+
+    // Collect the contacts which need a narrow phase test first. Signals are published after all tests were run,
+    // as listeners might change the components the tests are reading.
+
+    NarrowPhaseTestList tests{createFrameAllocator<NarrowPhaseTest>()};
+    tests.reserve(contactManager_->size());
+
+    IndexList testedContacts{createFrameAllocator<uint32_t>()};
+    testedContacts.reserve(contactManager_->size());
+
+    ContactList endedContacts{createFrameAllocator<Contact>()};
+
+    struct BodyNode
+    {
+        const AABB* aabb;
+        bool moved;
+    };
+
+    // returns the enlarged bounds of a body, static bodies never move
+    auto findNode = [this](entt::entity entity)
+    {
+        if (!registry_->valid(entity))
+            return BodyNode{nullptr, false};
+
+        if (const auto* nodeInfo = registry_->try_get<const NodeInfo>(entity); nodeInfo)
+        {
+            if (nodeInfo->nodeId == InvalidIndex)
+                return BodyNode{nullptr, false};
+            return BodyNode{&broadphase_->fatAABB(nodeInfo->nodeId), nodeInfo->movedFrame == frame_};
+        }
+
+        if (const auto* nodeInfo = registry_->try_get<const StaticNodeInfo>(entity); nodeInfo)
+        {
+            if (nodeInfo->nodeId == InvalidIndex)
+                return BodyNode{nullptr, false};
+            return BodyNode{&staticTree_->fatAABB(nodeInfo->nodeId), false};
+        }
+
+        return BodyNode{nullptr, false};
+    };
+
+    uint32_t index = 0;
+    while (index < contactManager_->size())
+    {
+        const auto& contact = contactManager_->contact(index);
+        const auto pair = contact.collision.pair;
+
+        const auto nodeA = findNode(pair.bodyA);
+        const auto nodeB = findNode(pair.bodyB);
+
+        const auto inTree = nodeA.aabb && nodeB.aabb;
+
+        const auto moved = inTree && (nodeA.moved || nodeB.moved);
+
+        // drop the contact if one of the bodies left the world or the fat AABBs do not overlap any longer
+        if (!inTree || (moved && !intersects(*nodeA.aabb, *nodeB.aabb)))
+        {
+            if (contact.collision.colliding)
+                endedContacts.push_back(contact);
+
+            contactManager_->removeContact(index);
+            continue;
+        }
 
-                collisionPairs.insert(std::move(pair));
+        // fast bodies were stopped at their first hit in advanceFastBodies(), they are tested like all others
+
+        if (moved)
+        {
+            tests.push_back(NarrowPhaseTest{
+                .pair = pair,
+                .shapeA = &registry_->get<const Shape>(pair.bodyA),
+                .shapeB = &registry_->get<const Shape>(pair.bodyB),
+            });
+            testedContacts.push_back(index);
+        }
+
+        index++;
+    }
+
+    const auto results = narrowPhase_->run(tests, createFrameAllocator<NarrowPhaseResult>());
+
+    // apply the results and publish the signals on this thread
+
+    // End is published for destroyed bodies too, with their stale ids, so that every Begin gets its End
+    auto publish = [this](const Collision& collision, ContactEvent event, bool sensor)
+    {
+        // bodies might have been destroyed by a listener
+        if (event != ContactEvent::End &&
+            (!registry_->valid(collision.pair.bodyA) || !registry_->valid(collision.pair.bodyB)))
+        {
+            return false;
+        }
+
+        collisionSignal_.publish(collision, event, sensor);
+
+        if (!batchListeners_.empty())
+            collisionEvents_.push_back({collision, event});
+
+        return true;
+    };
+
+    for (const auto& contact : endedContacts)
+        publish(contact.collision, ContactEvent::End, contact.sensor);
+
+    // contacts passed to the solver
+    IndexList collisions{createFrameAllocator<uint32_t>()};
+    collisions.reserve(results.size());
+
+    uint32_t nextTest{};
+    auto nextResult = results.begin();
+
+    for (index = 0; index < contactManager_->size(); index++)
+    {
+        auto& contact = contactManager_->contact(index);
+
+        if (nextTest == testedContacts.size() || testedContacts[nextTest] != index)
+        {
+            // nothing changed since the last narrow phase test
+            if (contact.collision.colliding)
+                publish(contact.collision, ContactEvent::Persist, contact.sensor);
+            continue;
+        }
+
+        const auto wasColliding = contact.collision.colliding;
+
+        if (nextResult != results.end() && nextResult->test == nextTest)
+        {
+            contact.collision = nextResult->collision;
+            ++nextResult;
+
+            const auto event = wasColliding ? ContactEvent::Persist : ContactEvent::Begin;
+            if (publish(contact.collision, event, contact.sensor))
+            {
+                if (!contact.sensor)
+                    collisions.push_back(index);
             }
-            return true;
-        };
+            else if (event == ContactEvent::Begin)
+            {
+                // nobody was told about the touch, so no End must follow when the contact is dropped
+                contact.collision.colliding = false;
+            }
+        }
+        else if (wasColliding)
+        {
+            publish(contact.collision, ContactEvent::End, contact.sensor);
+
+            contact.collision.colliding = false;
+            contact.normalImpulse = 0.0f;
+        }
 
-        dynamicTree_->query(node.aabb, callback);
+        nextTest++;
     }
 
-    return collisionPairs;
+    stats_.narrowPhaseCount = static_cast<uint32_t>(tests.size());
+
+    return collisions;
 }
 
-CollisionList World::findActualCollsions(const CollisionPairSet& collisionPairs)
+void World::updateSleep(float deltaTime)
 {
     NGN_INSTRUMENT_FUNCTION();
 
-    CollisionList collisions{app_->createFrameAllocator<Collision>()};
-    collisions.reserve(collisionPairs.size());
-
-    for (const auto& col : collisionPairs)
+    if (!config_.allowSleep)
     {
-        // HINT
-        // Fast moving bodies would need a special handling of collision
-        // detection and solving. But since actually only shots are fast
-        // moving, correct solving is not needed as they hit something.
+        stats_.sleepingCount = 0;
+        return;
+    }
 
-        const auto& shapeA = registry_->get<Shape>(col.bodyA);
-        const auto& shapeB = registry_->get<Shape>(col.bodyB);
+    // Bodies touching each other form an island, which falls asleep when all of its bodies have been resting for
+    // timeToSleep and is woken as soon as one of them moves again. Static bodies do not connect islands.
 
-        Collision collision{.pair = col};
-        testCollision(collision, shapeA, shapeB);
+    std::vector<IslandNode, LinearAllocator<IslandNode>> nodes{createFrameAllocator<IslandNode>()};
 
-        if (collision.colliding)
+    auto addNode = [this, &nodes](entt::entity entity, SleepInfo& sleepInfo, bool sleeping)
+    {
+        if (sleepInfo.islandFrame != frame_)
         {
-#if defined(NGN_ENABLE_VISUAL_DEBUGGING)
-            debugCollisions_.insert_or_assign(col, collision);
-#endif
+            sleepInfo.islandFrame = frame_;
+            sleepInfo.islandNode = static_cast<uint32_t>(nodes.size());
+
+            nodes.push_back(IslandNode{
+                .entity = entity,
+                .parent = sleepInfo.islandNode,
+                .sleeping = sleeping,
+                .restless = !sleeping && sleepInfo.time < config_.timeToSleep,
+            });
+        }
+        return sleepInfo.islandNode;
+    };
 
-            const auto bodyA = registry_->get<const Body>(col.bodyA);
-            const auto bodyB = registry_->get<const Body>(col.bodyB);
+    auto findRoot = [&nodes](uint32_t node)
+    {
+        while (nodes[node].parent != node)
+        {
+            nodes[node].parent = nodes[nodes[node].parent].parent;
+            node = nodes[node].parent;
+        }
+        return node;
+    };
 
-            const auto sensor = bodyA.sensor || bodyB.sensor;
+    const auto linearLimit2 = config_.sleepLinearVelocity * config_.sleepLinearVelocity;
 
-            collisionSignal_.publish(collision, sensor);
+    auto awakeView = registry_->view<
+            const LinearVelocity,
+            const AngularVelocity,
+            SleepInfo,
+            ActiveTag>(entt::exclude<SleepingTag>);
+    for (auto [e, linVelocity, angVelocity, sleepInfo] : awakeView.each())
+    {
+        const auto resting = glm::length2(linVelocity.value) < linearLimit2 &&
+                             glm::abs(angVelocity.value) < config_.sleepAngularVelocity;
+        sleepInfo.time = resting ? sleepInfo.time + deltaTime : 0.0f;
 
-            if (!sensor)
-                collisions.push_back(std::move(collision));
+        addNode(e, sleepInfo, false);
+    }
+
+    // all awake bodies have a node, the others reached through contacts are sleeping
+    for (const auto& contact : contactManager_->contacts())
+    {
+        if (!contact.collision.colliding || contact.sensor)
+            continue;
+
+        const auto pair = contact.collision.pair;
+        if (!registry_->valid(pair.bodyA) || !registry_->valid(pair.bodyB))
+            continue;
+
+        auto* sleepInfoA = registry_->try_get<SleepInfo>(pair.bodyA);
+        auto* sleepInfoB = registry_->try_get<SleepInfo>(pair.bodyB);
+        if (!sleepInfoA || !sleepInfoB)
+            continue;
+
+        const auto rootA = findRoot(addNode(pair.bodyA, *sleepInfoA, true));
+        const auto rootB = findRoot(addNode(pair.bodyB, *sleepInfoB, true));
+        if (rootA != rootB)
+        {
+            nodes[rootB].parent = rootA;
+            nodes[rootA].restless = nodes[rootA].restless || nodes[rootB].restless;
         }
     }
 
-    return collisions;
+    for (uint32_t index = 0; index < nodes.size(); index++)
+    {
+        const auto& node = nodes[index];
+        const auto awake = nodes[findRoot(index)].restless;
+
+        if (awake && node.sleeping)
+        {
+            wakeBody(node.entity);
+        }
+        else if (!awake && !node.sleeping)
+        {
+            registry_->emplace<SleepingTag>(node.entity);
+
+            auto [linVelocity, angVelocity] = registry_->get<LinearVelocity, AngularVelocity>(node.entity);
+            linVelocity.value = {};
+            angVelocity.value = 0.0f;
+        }
+    }
+
+    stats_.sleepingCount = static_cast<uint32_t>(registry_->view<SleepingTag>().size());
 }
 
 #if defined(NGN_ENABLE_VISUAL_DEBUGGING)
 
 void World::debugDrawState(DebugRenderer* debugRenderer, bool shapes, bool boundingBoxes, bool tree, bool collisions)
 {
-    auto drawShape = [](DebugRenderer* renderer, const Shape& shape, const glm::vec4& color)
+    // boxes and convex polygons share the outline and the fill by their vertices, box corners are kept in storage
+    auto polygonOf = [](const Shape& shape, std::array<glm::vec2, 4>& storage) -> std::span<const glm::vec2>
+    {
+        if (shape.type == Shape::Type::ConvexPolygon)
+            return {shape.polygon.vertices, shape.polygon.count};
+
+        storage = shape.box.corners();
+        return storage;
+    };
+
+    auto drawShape = [&polygonOf](DebugRenderer* renderer, const Shape& shape, const glm::vec4& color)
     {
         switch (shape.type)
         {
@@ -370,12 +1218,22 @@ void World::debugDrawState(DebugRenderer* debugRenderer, bool shapes, bool bound
                 renderer->drawCapsule(shape.capsule.start, shape.capsule.end, shape.capsule.radius, color);
                 break;
 
+            case Box:
+            case ConvexPolygon:
+            {
+                std::array<glm::vec2, 4> corners;
+                const auto vertices = polygonOf(shape, corners);
+                for (std::size_t i = 0; i < vertices.size(); i++)
+                    renderer->drawLine(vertices[i], vertices[(i + 1) % vertices.size()], color);
+                break;
+            }
+
             case Invalid:
                 break;
         }
     };
 
-    auto fillShape = [](DebugRenderer* renderer, const Shape& shape, const glm::vec4& color)
+    auto fillShape = [&polygonOf](DebugRenderer* renderer, const Shape& shape, const glm::vec4& color)
     {
         switch (shape.type)
         {
@@ -393,6 +1251,17 @@ void World::debugDrawState(DebugRenderer* debugRenderer, bool shapes, bool bound
                 renderer->fillCapsule(shape.capsule.start, shape.capsule.end, shape.capsule.radius, color);
                 break;
 
+            case Box:
+            case ConvexPolygon:
+            {
+                // the shapes are convex, so a fan from the first vertex covers them
+                std::array<glm::vec2, 4> corners;
+                const auto vertices = polygonOf(shape, corners);
+                for (std::size_t i = 1; i + 1 < vertices.size(); i++)
+                    renderer->fillTriangle(vertices[0], vertices[i], vertices[i + 1], color);
+                break;
+            }
+
             case Invalid:
                 break;
         }
@@ -408,55 +1277,65 @@ void World::debugDrawState(DebugRenderer* debugRenderer, bool shapes, bool bound
 
     if (boundingBoxes)
     {
-        dynamicTree_->walkTree([debugRenderer, tree](const TreeNode& node)
+        auto drawBounds = [debugRenderer, tree](const AABB& aabb, bool object)
+        {
+            if (object || tree)
+                debugRenderer->drawAABB(aabb.topLeft, aabb.bottomRight, {1, 0, 1, 0.3});
+        };
+
+        broadphase_->walkBounds(drawBounds);
+        staticTree_->walkTree([&drawBounds](const TreeNode& node)
         {
-            if (node.isLeaf() || tree)
-                debugRenderer->drawAABB(node.aabb.topLeft, node.aabb.bottomRight, {1, 0, 1, 0.3});
+            drawBounds(node.aabb, node.isLeaf());
             return true;
         });
     }
 
+    auto findAABB = [this](entt::entity entity) -> const AABB*
+    {
+        if (const auto* nodeInfo = registry_->try_get<const NodeInfo>(entity); nodeInfo)
+            return nodeInfo->nodeId != InvalidIndex ? &broadphase_->fatAABB(nodeInfo->nodeId) : nullptr;
+        if (const auto* nodeInfo = registry_->try_get<const StaticNodeInfo>(entity); nodeInfo)
+            return nodeInfo->nodeId != InvalidIndex ? &staticTree_->fatAABB(nodeInfo->nodeId) : nullptr;
+        return nullptr;
+    };
+
     if (collisions)
     {
-        if (boundingBoxes)
+        for (const auto& contact : contactManager_->contacts())
         {
-            for (const auto& col : debugPossibleCollisions_)
+            const auto& col = contact.collision;
+
+            // bodies might have been destroyed by collision listeners
+            if (!registry_->valid(col.pair.bodyA) || !registry_->valid(col.pair.bodyB))
+                continue;
+
+            if (boundingBoxes)
             {
-                debugRenderer->drawAABB(col.second.aabb1.topLeft, col.second.aabb1.bottomRight, {1, 1, 0, 0.6});
-                debugRenderer->drawAABB(col.second.aabb2.topLeft, col.second.aabb2.bottomRight, {1, 1, 0, 0.6});
+                const auto* aabbA = findAABB(col.pair.bodyA);
+                const auto* aabbB = findAABB(col.pair.bodyB);
+                if (aabbA && aabbB)
+                {
+                    debugRenderer->drawAABB(aabbA->topLeft, aabbA->bottomRight, {1, 1, 0, 0.6});
+                    debugRenderer->drawAABB(aabbB->topLeft, aabbB->bottomRight, {1, 1, 0, 0.6});
+                }
             }
-        }
 
-        for (const auto& col : debugCollisions_)
-        {
-            drawShape(debugRenderer, registry_->get<Shape>(col.first.bodyA), {1, 0, 0, 0.9});
-            drawShape(debugRenderer, registry_->get<Shape>(col.first.bodyB), {1, 0, 0, 0.9});
-            const auto penVec = col.second.direction * col.second.penetration;
-            const auto start = col.second.point - penVec / 2.f;
+            if (!col.colliding)
+                continue;
+
+            drawShape(debugRenderer, registry_->get<Shape>(col.pair.bodyA), {1, 0, 0, 0.9});
+            drawShape(debugRenderer, registry_->get<Shape>(col.pair.bodyB), {1, 0, 0, 0.9});
+            const auto penVec = col.direction * col.penetration;
+            const auto start = col.point - penVec / 2.f;
             const auto end = start + penVec;
-            debugRenderer->drawCircle(col.second.point, 2.f, {1, 0, 0, 0.9});
+            debugRenderer->drawCircle(col.point, 2.f, {1, 0, 0, 0.9});
             debugRenderer->drawCircle(start, 1.f, {1, 0, 0, 0.9});
             debugRenderer->drawLine(start, end, {1, 0, 0, 0.9});
         }
     }
 }
 
-void World::removeDebugState(entt::entity entity)
-{
-    for (auto it = debugPossibleCollisions_.begin(); it != debugPossibleCollisions_.end(); )
-    {
-        if (it->first.contains(entity))
-        {
-            debugCollisions_.erase(it->first);
-            it = debugPossibleCollisions_.erase(it);
-        }
-        else
-        {
-            it++;
-        }
-    }
-}
-
 #endif
 
 } // namespace ngn
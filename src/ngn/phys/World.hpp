@@ -3,15 +3,25 @@
 
 #pragma once
 
+#include "Broadphase.hpp"
+#include "ChangeSet.hpp"
+#include "ContactManager.hpp"
 #include "DynamicTree.hpp"
 #include "Macros.hpp"
 #include "Shapes.hpp"
 #include "phys/Collision.hpp"
 #include <entt/entt.hpp>
+#include <array>
+#include <deque>
+#include <span>
+#include <vector>
 
 namespace ngn {
 
-class Application;
+class ContactSolver;
+class JobSystem;
+class MemoryArena;
+class NarrowPhase;
 
 class BodyCreateInfo
 {
@@ -23,6 +33,7 @@ public:
     bool dynamic{true};
     bool useForce{true};
     bool fastMoving{false};
+    CollisionFilter filter{};
 };
 
 class WorldConfig
@@ -31,69 +42,294 @@ public:
     float linearDamping{1.0f};
     float angularDamping{1.0f};
     glm::vec2 gravity{};
+    // structure finding the pairs of dynamic bodies, static bodies are always kept in a tree
+    BroadphaseType broadphase{BroadphaseType::Tree};
+    // inner nodes of the dynamic tree checked for cheaper rotations per update, see DynamicTree::optimize()
+    uint32_t treeOptimizeBudget{16};
+    // updates between two moves of the dynamic tree nodes into depth first order, see DynamicTree::relayout(), 0 never
+    uint32_t treeRelayoutInterval{64};
+    // edge length of the grid cells, about the size of the common bodies
+    float gridCellSize{128.0f};
+    // bodies slower than this are resting, islands of bodies resting for timeToSleep are put to sleep
+    bool allowSleep{true};
+    float sleepLinearVelocity{5.0f};
+    float sleepAngularVelocity{0.1f};
+    float timeToSleep{0.5f};
+    // velocity iterations of the contact solver, warm starting begins every update with the last impulses
+    uint32_t solverIterations{8};
+    bool warmStarting{true};
+};
+
+class WorldStats
+{
+public:
+    // stage times in cpu timer ticks, see instrumentation::cpuTimer()
+    uint64_t updateActiveTime{};
+    uint64_t integrateTime{};
+    uint64_t updateTreeTime{};
+    uint64_t findPossibleCollisionsTime{};
+    uint64_t findActualCollisionsTime{};
+    uint64_t resolveCollisionsTime{};
+    uint64_t updateSleepTime{};
+
+    uint32_t movedCount{};
+    uint32_t possibleCollisionCount{};
+    uint32_t narrowPhaseCount{};
+    uint32_t collisionCount{};
+    uint32_t sleepingCount{};
+    // fast bodies stopped at their time of impact
+    uint32_t timeOfImpactCount{};
+    // independent batches the contacts were partitioned into
+    uint32_t solverColorCount{};
+
+    // updated when the static tree is built
+    TreeStats staticTree{};
+};
+
+// matches every body in the tag filter of a collision batch listener
+class AnyBody
+{
 };
 
 class World
 {
 public:
     using CollisionCallback = entt::delegate<void(const Collision&)>;
+    using CollisionBatchCallback = entt::delegate<void(std::span<const Collision>)>;
 
 public:
-    World(Application* app);
+    World(entt::registry* registry, MemoryArena* frameMemoryArena, JobSystem* jobSystem);
     ~World();
 
+    // changing the broadphase settings moves all bodies into a new broadphase
     void setConfig(WorldConfig config);
 
+    // statistics of the last update() call
+    const WorldStats& stats() const { return stats_; }
+    // walks the whole broadphase, meant for diagnostics
+    BroadphaseStats broadphaseStats() const;
+
+    // Listeners are called as (const Collision&, ContactEvent, bool sensor), trailing arguments may be omitted.
+    // Persist is published every frame while the bodies are touching, End carries the last touching collision. End
+    // is also published when a body is deactivated, removed or destroyed. For destroyed bodies it carries their stale
+    // ids, listeners must not access their components.
     template<auto Callback>
     entt::connection addCollisionListener();
     template<auto Callback, typename Type>
     entt::connection addCollisionListener(Type arg);
 
+    // Batch listeners are called as (std::span<const Collision>) once at the end of update() with the collisions of
+    // the given event in which one body has the component TagA and the other one TagB. The pairs are turned around
+    // such that bodyA has TagA. Listeners without matching collisions are not called, bodies destroyed by an earlier
+    // listener are left out of Begin and Persist. Destroyed bodies in End only match AnyBody, as their components are
+    // gone. Returns the id to remove the listener with.
+    template<auto Callback, typename TagA, typename TagB>
+    uint32_t addCollisionBatchListener(ContactEvent event);
+    template<auto Callback, typename TagA, typename TagB, typename Type>
+    uint32_t addCollisionBatchListener(ContactEvent event, Type arg);
+    void removeCollisionBatchListener(uint32_t id);
+
+    // Bodies created with dynamic = false are kept in a separate tree which is bulk built whenever static bodies are
+    // added, removed, activated or deactivated. They must not be moved after creation.
     void createBody(entt::entity entity, const BodyCreateInfo& createInfo, Shape shape);
 
     void update(float deltaTime);
 
+    // Must be called after the position, rotation or scale of a body was set directly. The next update moves it in
+    // the broadphase and wakes it if it is sleeping.
+    void markTransformChanged(entt::entity entity) { transformChanges_.mark(entity); }
+
+    // Wakes the body together with the bodies touching it. Bodies are also woken when a force is applied to them or
+    // their transform is marked as changed.
+    void wakeBody(entt::entity entity);
+
     template<typename Callback>
     inline void query(const AABB& aabb, const Callback& callback) const
     {
-        return dynamicTree_->query(aabb, callback);
+        bool proceed = true;
+        staticTree_->query(aabb, [&callback, &proceed](entt::entity entity, const AABB& nodeAabb)
+        {
+            proceed = callback(entity, nodeAabb);
+            return proceed;
+        });
+
+        if (proceed)
+            broadphase_->query(aabb, callback);
+    }
+
+    // Calls callback(const RayHit&) for active bodies whose shape is hit by the segment, not sorted by distance. The
+    // callback returns how to go on: a negative value ignores the hit, 0 stops the cast, hit.fraction only looks for
+    // closer hits and 1 reports all hits.
+    template<typename Callback>
+    void segmentCast(const Line& segment, const Callback& callback) const;
+
+    template<typename Callback>
+    void rayCast(const glm::vec2& origin, const glm::vec2& direction, float distance, const Callback& callback) const
+    {
+        segmentCast(Line{.start = origin, .end = origin + direction * distance}, callback);
     }
 
+    // Nearest hit of the segment, bodies for which filter(entity) returns false are passed through.
+    template<typename Filter>
+    bool segmentCastClosest(const Line& segment, RayHit& hit, const Filter& filter) const;
+
+    // First hit found along the segment, which is not necessarily the nearest one.
+    template<typename Filter>
+    bool segmentCastAny(const Line& segment, RayHit& hit, const Filter& filter) const;
+
 #if defined(NGN_ENABLE_VISUAL_DEBUGGING)
     void debugDrawState(class DebugRenderer* debugRenderer, bool shapes, bool boundingBoxes, bool tree, bool collisions);
 #endif
 
 private:
+    class CollisionBatchListener
+    {
+    public:
+        CollisionBatchCallback callback;
+        // nullptr matches any body
+        const entt::sparse_set* tagA;
+        const entt::sparse_set* tagB;
+        ContactEvent event;
+        uint32_t id;
+        // removed while the batches were delivered, erased afterwards
+        bool removed;
+    };
+
+    class CollisionEventRecord
+    {
+    public:
+        Collision collision;
+        ContactEvent event;
+    };
+
+private:
+    template<typename Tag>
+    const entt::sparse_set* tagStorage()
+    {
+        if constexpr (std::is_same_v<Tag, AnyBody>)
+            return nullptr;
+        else
+            return &registry_->storage<Tag>();
+    }
+
+    uint32_t addCollisionBatchListener(CollisionBatchCallback callback, const entt::sparse_set* tagA,
+                                       const entt::sparse_set* tagB, ContactEvent event);
+    void deliverCollisionBatches();
+
     Shape transformShape(entt::entity entity, const Shape& origShape);
+    const glm::vec2* allocatePolygonVertices(const ConvexPolygon& polygon);
+    void onShapeRemoved(entt::registry& registry, entt::entity entity);
     void updateActive();
-    void integrate(float deltaTime);
+    void updateStatic();
+    void onStaticBodyAdded(entt::registry& registry, entt::entity entity);
+    void onStaticBodyRemoved(entt::registry& registry, entt::entity entity);
+    void onDynamicBodyToggled(entt::registry& registry, entt::entity entity);
+    void onDynamicBodyRemoved(entt::registry& registry, entt::entity entity);
+    void wakeChangedBodies();
+    EntityList integrate(float deltaTime);
+    void advanceFastBodies(const EntityList& fastBodies);
     MovedList updateTree();
-    CollisionPairSet findPossibleCollisions(const MovedList& moved);
-    CollisionList findActualCollsions(const CollisionPairSet& collisionPairs);
+    void findPossibleCollisions(const MovedList& moved);
+    IndexList findActualCollsions();
+    void updateSleep(float deltaTime);
+
+    template<typename T>
+    LinearAllocator<T> createFrameAllocator() const
+    {
+        return LinearAllocator<T>{frameMemoryArena_};
+    }
 
 private:
-    Application* app_;
     entt::registry* registry_;
-    DynamicTree* dynamicTree_;
+    MemoryArena* frameMemoryArena_;
+    JobSystem* jobSystem_;
+    Broadphase* broadphase_;
+    DynamicTree* staticTree_;
+    ContactManager* contactManager_;
+    NarrowPhase* narrowPhase_;
+    ContactSolver* solver_;
 
     WorldConfig config_;
+    WorldStats stats_;
+    uint32_t frame_;
+    bool staticDirty_;
+    // dynamic bodies whose ActiveTag was added or removed since the last update, may contain duplicates
+    std::vector<entt::entity> activeChanged_;
+    // bodies to move in the broadphase by the next update
+    ChangeSet transformChanges_;
+    // Vertices of the polygons of bodies, the local ones of NodeInfo::origShape followed by the transformed ones of the
+    // Shape component. The deque keeps their addresses when it grows.
+    std::deque<std::array<glm::vec2, 2 * ConvexPolygon::MaxVertices>> polygonVertices_;
+    std::vector<glm::vec2*> freePolygonVertices_;
 
-    entt::sigh<void(const Collision&, bool sensor)> collisionSignal_;
+    entt::sigh<void(const Collision&, ContactEvent event, bool sensor)> collisionSignal_;
 
-#if defined(NGN_ENABLE_VISUAL_DEBUGGING)
-    struct AABBPair
-    {
-        AABB aabb1;
-        AABB aabb2;
-    };
-    std::unordered_map<CollisionPair, AABBPair> debugPossibleCollisions_;
-    std::unordered_map<CollisionPair, Collision> debugCollisions_;
-    void removeDebugState(entt::entity entity);
-#endif
+    std::vector<CollisionBatchListener> batchListeners_;
+    uint32_t nextBatchListenerId_;
+    bool deliveringBatches_;
+    // events of the update, only recorded while there are batch listeners
+    std::vector<CollisionEventRecord> collisionEvents_;
+    std::vector<Collision> collisionBatch_;
 
     NGN_DISABLE_COPY_MOVE(World)
 };
 
+template<typename Callback>
+inline void World::segmentCast(const Line& segment, const Callback& callback) const
+{
+    auto castShape = [this, &segment, &callback](entt::entity entity, float maxFraction)
+    {
+        RayHit hit;
+        if (!testRayCast(hit, segment, maxFraction, registry_->get<const Shape>(entity)))
+            return maxFraction;
+
+        hit.entity = entity;
+
+        const float fraction = callback(hit);
+        return fraction < 0.0f ? maxFraction : fraction;
+    };
+
+    const auto maxFraction = staticTree_->rayCast(segment, 1.0f, castShape);
+    if (maxFraction > 0.0f)
+        broadphase_->rayCast(segment, maxFraction, castShape);
+}
+
+template<typename Filter>
+inline bool World::segmentCastClosest(const Line& segment, RayHit& hit, const Filter& filter) const
+{
+    bool found = false;
+
+    segmentCast(segment, [&hit, &filter, &found](const RayHit& candidate)
+    {
+        if (!filter(candidate.entity))
+            return -1.0f;
+
+        hit = candidate;
+        found = true;
+        return candidate.fraction;
+    });
+
+    return found;
+}
+
+template<typename Filter>
+inline bool World::segmentCastAny(const Line& segment, RayHit& hit, const Filter& filter) const
+{
+    bool found = false;
+
+    segmentCast(segment, [&hit, &filter, &found](const RayHit& candidate)
+    {
+        if (!filter(candidate.entity))
+            return -1.0f;
+
+        hit = candidate;
+        found = true;
+        return 0.0f;
+    });
+
+    return found;
+}
+
 template<auto Callback>
 inline entt::connection World::addCollisionListener()
 {
@@ -108,4 +344,20 @@ inline entt::connection World::addCollisionListener(Type arg)
     return s.connect<Callback>(arg);
 }
 
+template<auto Callback, typename TagA, typename TagB>
+inline uint32_t World::addCollisionBatchListener(ContactEvent event)
+{
+    CollisionBatchCallback callback;
+    callback.connect<Callback>();
+    return addCollisionBatchListener(callback, tagStorage<TagA>(), tagStorage<TagB>(), event);
+}
+
+template<auto Callback, typename TagA, typename TagB, typename Type>
+inline uint32_t World::addCollisionBatchListener(ContactEvent event, Type arg)
+{
+    CollisionBatchCallback callback;
+    callback.connect<Callback>(arg);
+    return addCollisionBatchListener(callback, tagStorage<TagA>(), tagStorage<TagB>(), event);
+}
+
 } // namespace ngn
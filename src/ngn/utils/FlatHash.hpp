@@ -0,0 +1,491 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Macros.hpp"
+#include <bit>
+#include <emmintrin.h>
+#include <memory>
+#include <utility>
+
+namespace ngn {
+
+// Hash used by FlatHashSet and FlatHashMap, specialize it for own key types. The result is mixed by the table, so
+// an identity hash is fine.
+template<typename T>
+struct FlatHash
+{
+    std::size_t operator()(const T& value) const { return std::hash<T>{}(value); }
+};
+
+namespace detail {
+
+// Open addressing hash table, storing one control byte per slot next to the slot array. Slots are probed in
+// groups of 16, so the control bytes of a group can be matched against the hash with a single SSE2 compare.
+// Full slots store the lower 7 bits of the hash in their control byte, empty and erased slots negative markers.
+template<typename Slot, typename Key, typename KeyOf, typename Hash, typename KeyEqual, typename Allocator>
+class FlatHashTable
+{
+protected:
+    using Ctrl = int8_t;
+
+    static constexpr std::size_t GroupWidth = 16;
+    static constexpr std::size_t NoIndex = std::numeric_limits<std::size_t>::max();
+    static constexpr Ctrl Empty = -128;
+    static constexpr Ctrl Deleted = -2;
+
+    using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+    using CtrlAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Ctrl>;
+
+    class Group
+    {
+    public:
+        explicit Group(const Ctrl* ctrl) :
+            ctrl_{_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))}
+        {
+        }
+
+        uint32_t match(Ctrl value) const
+        {
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(value))));
+        }
+
+        uint32_t matchEmpty() const { return match(Empty); }
+
+        uint32_t matchEmptyOrDeleted() const
+        {
+            // full slots are positive, both markers are less than -1
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl_)));
+        }
+
+    private:
+        __m128i ctrl_;
+    };
+
+    template<bool Const>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Slot;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const Slot*, Slot*>;
+        using reference = std::conditional_t<Const, const Slot&, Slot&>;
+
+        Iterator() = default;
+
+        Iterator(const FlatHashTable* table, std::size_t index) :
+            table_{table},
+            index_{index}
+        {
+            skipFree();
+        }
+
+        template<bool OtherConst> requires (Const && !OtherConst)
+        Iterator(const Iterator<OtherConst>& other) :
+            table_{other.table_},
+            index_{other.index_}
+        {
+        }
+
+        reference operator*() const { return table_->slots_[index_]; }
+        pointer operator->() const { return table_->slots_ + index_; }
+
+        Iterator& operator++()
+        {
+            index_++;
+            skipFree();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const Iterator& lhs, const Iterator& rhs) { return lhs.index_ == rhs.index_; }
+
+    private:
+        void skipFree()
+        {
+            while (index_ < table_->capacity_ && table_->ctrl_[index_] < 0)
+                index_++;
+        }
+
+    private:
+        const FlatHashTable* table_{};
+        std::size_t index_{};
+
+        template<bool>
+        friend class Iterator;
+        friend class FlatHashTable;
+    };
+
+public:
+    using key_type = Key;
+    using value_type = Slot;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+public:
+    explicit FlatHashTable(const Allocator& allocator = Allocator{}) :
+        slotAllocator_{allocator},
+        ctrlAllocator_{allocator}
+    {
+    }
+
+    FlatHashTable(FlatHashTable&& other) noexcept :
+        slotAllocator_{other.slotAllocator_},
+        ctrlAllocator_{other.ctrlAllocator_},
+        ctrl_{std::exchange(other.ctrl_, nullptr)},
+        slots_{std::exchange(other.slots_, nullptr)},
+        capacity_{std::exchange(other.capacity_, 0)},
+        size_{std::exchange(other.size_, 0)},
+        growthLeft_{std::exchange(other.growthLeft_, 0)}
+    {
+    }
+
+    FlatHashTable& operator=(FlatHashTable&& other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            slotAllocator_ = other.slotAllocator_;
+            ctrlAllocator_ = other.ctrlAllocator_;
+            ctrl_ = std::exchange(other.ctrl_, nullptr);
+            slots_ = std::exchange(other.slots_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_ = std::exchange(other.size_, 0);
+            growthLeft_ = std::exchange(other.growthLeft_, 0);
+        }
+        return *this;
+    }
+
+    ~FlatHashTable()
+    {
+        destroy();
+    }
+
+    size_type size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_type capacity() const { return capacity_; }
+
+    iterator begin() { return iterator{this, 0}; }
+    const_iterator begin() const { return const_iterator{this, 0}; }
+    const_iterator cbegin() const { return const_iterator{this, 0}; }
+
+    iterator end() { return iterator{this, capacity_}; }
+    const_iterator end() const { return const_iterator{this, capacity_}; }
+    const_iterator cend() const { return const_iterator{this, capacity_}; }
+
+    iterator find(const Key& key)
+    {
+        const auto index = findIndex(key);
+        return iterator{this, index == NoIndex ? capacity_ : index};
+    }
+
+    const_iterator find(const Key& key) const
+    {
+        const auto index = findIndex(key);
+        return const_iterator{this, index == NoIndex ? capacity_ : index};
+    }
+
+    bool contains(const Key& key) const { return findIndex(key) != NoIndex; }
+
+    size_type erase(const Key& key)
+    {
+        const auto index = findIndex(key);
+        if (index == NoIndex)
+            return 0;
+        eraseIndex(index);
+        return 1;
+    }
+
+    iterator erase(const_iterator it)
+    {
+        eraseIndex(it.index_);
+        return iterator{this, it.index_ + 1};
+    }
+
+    void clear()
+    {
+        for (std::size_t i = 0; i < capacity_; i++)
+        {
+            if (ctrl_[i] >= 0)
+                std::destroy_at(slots_ + i);
+            ctrl_[i] = Empty;
+        }
+        size_ = 0;
+        growthLeft_ = maxLoad(capacity_);
+    }
+
+    void reserve(size_type count)
+    {
+        auto capacity = GroupWidth;
+        while (maxLoad(capacity) < count)
+            capacity *= 2;
+
+        if (capacity > capacity_)
+            rehash(capacity);
+    }
+
+protected:
+    static std::size_t mix(std::size_t hash)
+    {
+        // finalizer of MurmurHash3, spreads identity hashes over all bits
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    static Ctrl h2(std::size_t hash) { return static_cast<Ctrl>(hash & 0x7F); }
+
+    // 7/8 of the slots may be used before the table grows
+    static std::size_t maxLoad(std::size_t capacity) { return capacity - capacity / 8; }
+
+    std::size_t findIndex(const Key& key) const
+    {
+        if (size_ == 0)
+            return NoIndex;
+
+        const auto hash = mix(Hash{}(key));
+        const auto groupMask = capacity_ / GroupWidth - 1;
+
+        auto group = (hash >> 7) & groupMask;
+        for (std::size_t step = 1; ; step++)
+        {
+            const auto base = group * GroupWidth;
+            const Group g{ctrl_ + base};
+
+            for (auto mask = g.match(h2(hash)); mask; mask &= mask - 1)
+            {
+                const auto index = base + static_cast<std::size_t>(std::countr_zero(mask));
+                if (KeyEqual{}(KeyOf{}(slots_[index]), key))
+                    return index;
+            }
+
+            // an insertion would have stopped here
+            if (g.matchEmpty())
+                return NoIndex;
+
+            // triangular probing visits every group once
+            group = (group + step) & groupMask;
+        }
+    }
+
+    std::size_t findFreeIndex(std::size_t hash) const
+    {
+        const auto groupMask = capacity_ / GroupWidth - 1;
+
+        auto group = (hash >> 7) & groupMask;
+        for (std::size_t step = 1; ; step++)
+        {
+            const auto base = group * GroupWidth;
+            if (const auto mask = Group{ctrl_ + base}.matchEmptyOrDeleted())
+                return base + static_cast<std::size_t>(std::countr_zero(mask));
+
+            group = (group + step) & groupMask;
+        }
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplaceKey(const Key& key, Args&&... args)
+    {
+        if (const auto index = findIndex(key); index != NoIndex)
+            return {iterator{this, index}, false};
+
+        if (growthLeft_ == 0)
+        {
+            // only grow if the table is really filled and not just full of erased slots
+            rehash(capacity_ == 0 ? GroupWidth : (size_ < maxLoad(capacity_) / 2 ? capacity_ : capacity_ * 2));
+        }
+
+        const auto hash = mix(Hash{}(key));
+        const auto index = findFreeIndex(hash);
+
+        if (ctrl_[index] == Empty)
+            growthLeft_--;
+
+        std::construct_at(slots_ + index, std::forward<Args>(args)...);
+        ctrl_[index] = h2(hash);
+        size_++;
+
+        return {iterator{this, index}, true};
+    }
+
+    void eraseIndex(std::size_t index)
+    {
+        assert(index < capacity_ && ctrl_[index] >= 0);
+
+        std::destroy_at(slots_ + index);
+        size_--;
+
+        // probing never continued beyond a group with an empty slot, so the slot does not need a marker
+        const auto base = index & ~(GroupWidth - 1);
+        if (Group{ctrl_ + base}.matchEmpty())
+        {
+            ctrl_[index] = Empty;
+            growthLeft_++;
+        }
+        else
+        {
+            ctrl_[index] = Deleted;
+        }
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        assert(std::has_single_bit(capacity) && capacity >= GroupWidth);
+
+        auto* oldCtrl = ctrl_;
+        auto* oldSlots = slots_;
+        const auto oldCapacity = capacity_;
+
+        ctrl_ = ctrlAllocator_.allocate(capacity);
+        slots_ = slotAllocator_.allocate(capacity);
+        capacity_ = capacity;
+        growthLeft_ = maxLoad(capacity) - size_;
+
+        std::fill_n(ctrl_, capacity, Empty);
+
+        for (std::size_t i = 0; i < oldCapacity; i++)
+        {
+            if (oldCtrl[i] < 0)
+                continue;
+
+            const auto hash = mix(Hash{}(KeyOf{}(oldSlots[i])));
+            const auto index = findFreeIndex(hash);
+
+            std::construct_at(slots_ + index, std::move(oldSlots[i]));
+            ctrl_[index] = h2(hash);
+
+            std::destroy_at(oldSlots + i);
+        }
+
+        if (oldCapacity)
+        {
+            slotAllocator_.deallocate(oldSlots, oldCapacity);
+            ctrlAllocator_.deallocate(oldCtrl, oldCapacity);
+        }
+    }
+
+    void destroy()
+    {
+        if (!capacity_)
+            return;
+
+        for (std::size_t i = 0; i < capacity_; i++)
+        {
+            if (ctrl_[i] >= 0)
+                std::destroy_at(slots_ + i);
+        }
+
+        slotAllocator_.deallocate(slots_, capacity_);
+        ctrlAllocator_.deallocate(ctrl_, capacity_);
+
+        ctrl_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = 0;
+        size_ = 0;
+        growthLeft_ = 0;
+    }
+
+private:
+    SlotAllocator slotAllocator_;
+    CtrlAllocator ctrlAllocator_;
+
+    Ctrl* ctrl_{};
+    Slot* slots_{};
+    std::size_t capacity_{};
+    std::size_t size_{};
+    std::size_t growthLeft_{};
+
+    NGN_DISABLE_COPY(FlatHashTable)
+};
+
+class SetKeyOf
+{
+public:
+    template<typename T>
+    const T& operator()(const T& value) const { return value; }
+};
+
+class MapKeyOf
+{
+public:
+    template<typename T>
+    const auto& operator()(const T& value) const { return value.first; }
+};
+
+} // namespace detail
+
+// ********************************************************
+
+template<typename Key, typename Hash = FlatHash<Key>, typename KeyEqual = std::equal_to<Key>,
+         typename Allocator = std::allocator<Key>>
+class FlatHashSet : public detail::FlatHashTable<Key, Key, detail::SetKeyOf, Hash, KeyEqual, Allocator>
+{
+    using Base = detail::FlatHashTable<Key, Key, detail::SetKeyOf, Hash, KeyEqual, Allocator>;
+
+public:
+    using Base::Base;
+    using typename Base::iterator;
+
+    std::pair<iterator, bool> insert(const Key& key) { return this->emplaceKey(key, key); }
+    std::pair<iterator, bool> insert(Key&& key) { return this->emplaceKey(key, std::move(key)); }
+};
+
+// ********************************************************
+
+template<typename Key, typename Value, typename Hash = FlatHash<Key>, typename KeyEqual = std::equal_to<Key>,
+         typename Allocator = std::allocator<std::pair<const Key, Value>>>
+class FlatHashMap : public detail::FlatHashTable<std::pair<const Key, Value>, Key, detail::MapKeyOf, Hash, KeyEqual,
+                                                 Allocator>
+{
+    using Base = detail::FlatHashTable<std::pair<const Key, Value>, Key, detail::MapKeyOf, Hash, KeyEqual, Allocator>;
+
+public:
+    using mapped_type = Value;
+    using Base::Base;
+    using typename Base::iterator;
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    {
+        return this->emplaceKey(key, std::piecewise_construct, std::forward_as_tuple(key),
+                                std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template<typename V>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value)
+    {
+        auto result = try_emplace(key, std::forward<V>(value));
+        if (!result.second)
+            result.first->second = std::forward<V>(value);
+        return result;
+    }
+
+    Value& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+    Value& at(const Key& key)
+    {
+        auto it = this->find(key);
+        assert(it != this->end());
+        return it->second;
+    }
+
+    const Value& at(const Key& key) const
+    {
+        auto it = this->find(key);
+        assert(it != this->end());
+        return it->second;
+    }
+};
+
+} // namespace ngn
@@ -0,0 +1,41 @@
+// Copyright 2026, Daniel Volk <mail@volkarts.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+namespace ngn {
+
+template<typename Signature>
+class FunctionRef;
+
+// Non owning reference to a callable, to pass callbacks through virtual functions without allocating. The callable
+// must outlive the reference.
+template<typename Result, typename... Args>
+class FunctionRef<Result(Args...)>
+{
+public:
+    template<typename Callable>
+        requires (!std::is_same_v<std::remove_cvref_t<Callable>, FunctionRef>)
+    FunctionRef(const Callable& callable) :
+        context_{&callable},
+        function_{[](const void* context, Args... args) -> Result
+        {
+            return (*static_cast<const Callable*>(context))(std::forward<Args>(args)...);
+        }}
+    {
+    }
+
+    Result operator()(Args... args) const
+    {
+        return function_(context_, std::forward<Args>(args)...);
+    }
+
+private:
+    const void* context_;
+    Result (*function_)(const void* context, Args... args);
+};
+
+} // namespace ngn